@@ -0,0 +1,276 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     Throughput and latency of the queues for different producer/consumer setups
+ *
+ * Usage: queue_benchmark [--items n] [--threads n] [--json]
+ * Writes one line per run, as csv with a header line or as json lines.
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/blocking_queue.h>
+#include <util/bounded_queue.h>
+#include <util/mpmc_queue.h>
+#include <util/priority_blocking_queue.h>
+#include <util/sharded_queue.h>
+#include <util/spsc_queue.h>
+
+namespace {
+
+  typedef std::chrono::steady_clock clock;
+
+  // --------------------------------------------------------------------------
+  /// Item of Size bytes, carrying its enqueue time. A negative stamp ends a consumer.
+  template<std::size_t Size>
+  struct payload {
+    std::int64_t stamp;
+    char data[Size - sizeof(std::int64_t)];
+  };
+
+  std::int64_t now_ns () {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+  }
+
+  // --------------------------------------------------------------------------
+  struct options {
+    std::size_t items = 200000;
+    std::size_t threads = std::max(2U, std::thread::hardware_concurrency() / 2);
+    bool json = false;
+  };
+
+  struct setup {
+    std::string queue;
+    std::string capacity;
+    std::size_t payload;
+    std::size_t producers;
+    std::size_t consumers;
+  };
+
+  struct result {
+    double seconds;
+    std::size_t items;
+    std::int64_t p50_ns;
+    std::int64_t p99_ns;
+  };
+
+  void print_header (const options& opt) {
+    if (!opt.json) {
+      std::cout << "queue,capacity,payload,producers,consumers,items,seconds,items_per_sec,p50_ns,p99_ns" << std::endl;
+    }
+  }
+
+  void print (const options& opt, const setup& s, const result& r) {
+    const double rate = r.seconds > 0 ? r.items / r.seconds : 0;
+    if (opt.json) {
+      std::cout << "{\"queue\":\"" << s.queue << "\",\"capacity\":\"" << s.capacity
+                << "\",\"payload\":" << s.payload << ",\"producers\":" << s.producers
+                << ",\"consumers\":" << s.consumers << ",\"items\":" << r.items
+                << ",\"seconds\":" << r.seconds << ",\"items_per_sec\":" << static_cast<std::uint64_t>(rate)
+                << ",\"p50_ns\":" << r.p50_ns << ",\"p99_ns\":" << r.p99_ns << "}" << std::endl;
+    } else {
+      std::cout << s.queue << ',' << s.capacity << ',' << s.payload << ',' << s.producers << ','
+                << s.consumers << ',' << r.items << ',' << r.seconds << ',' << static_cast<std::uint64_t>(rate)
+                << ',' << r.p50_ns << ',' << r.p99_ns << std::endl;
+    }
+  }
+
+  // --------------------------------------------------------------------------
+  // Uniform access to the different queue interfaces.
+
+  template<typename Q, typename = void>
+  struct has_close : std::false_type {};
+
+  template<typename Q>
+  struct has_close<Q, std::void_t<decltype(std::declval<Q&>().close())>> : std::true_type {};
+
+  template<typename Q, typename T>
+  void put (Q& q, T&& t) {
+    q.enqueue(std::forward<T>(t));
+  }
+
+  template<typename T, typename U>
+  void put (util::priority_blocking_queue<T>& q, U&& t) {
+    q.enqueue(0, std::forward<U>(t));
+  }
+
+  /// Closable queues are closed, the others get one end marker per consumer.
+  template<typename T, typename Q>
+  void finish (Q& q, std::size_t consumers) {
+    if constexpr (has_close<Q>::value) {
+      q.close();
+    } else {
+      for (std::size_t i = 0; i < consumers; ++i) {
+        T t = T();
+        t.stamp = -1;
+        put(q, std::move(t));
+      }
+    }
+  }
+
+  /// Dequeues until the queue is closed or the end marker arrives, collects the latencies.
+  template<typename T, typename Q>
+  void drain (Q& q, std::vector<std::int64_t>& latencies) {
+    if constexpr (has_close<Q>::value) {
+      while (auto t = q.pop()) {
+        latencies.push_back(now_ns() - t->stamp);
+      }
+    } else {
+      for (;;) {
+        const T t = q.dequeue();
+        if (t.stamp < 0) {
+          return;
+        }
+        latencies.push_back(now_ns() - t.stamp);
+      }
+    }
+  }
+
+  // --------------------------------------------------------------------------
+  template<typename T, typename Q>
+  result run (Q& q, std::size_t items, std::size_t producers, std::size_t consumers) {
+    std::vector<std::vector<std::int64_t>> latencies(consumers);
+    for (auto& l : latencies) {
+      l.reserve(items / consumers + 1);
+    }
+    const std::size_t per_producer = items / producers;
+
+    const clock::time_point start = clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < consumers; ++i) {
+      threads.emplace_back([&, i] () {
+        drain<T>(q, latencies[i]);
+      });
+    }
+    std::vector<std::thread> feeders;
+    for (std::size_t i = 0; i < producers; ++i) {
+      feeders.emplace_back([&] () {
+        for (std::size_t n = 0; n < per_producer; ++n) {
+          T t = T();
+          t.stamp = now_ns();
+          put(q, std::move(t));
+        }
+      });
+    }
+    for (auto& t : feeders) {
+      t.join();
+    }
+    finish<T>(q, consumers);
+    for (auto& t : threads) {
+      t.join();
+    }
+    const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+    std::vector<std::int64_t> all;
+    all.reserve(items);
+    for (auto& l : latencies) {
+      all.insert(all.end(), l.begin(), l.end());
+    }
+    result r = {seconds, all.size(), 0, 0};
+    if (!all.empty()) {
+      auto p50 = all.begin() + static_cast<std::ptrdiff_t>(all.size() / 2);
+      std::nth_element(all.begin(), p50, all.end());
+      r.p50_ns = *p50;
+      auto p99 = all.begin() + static_cast<std::ptrdiff_t>(all.size() * 99 / 100);
+      std::nth_element(all.begin(), p99, all.end());
+      r.p99_ns = *p99;
+    }
+    return r;
+  }
+
+  /// Runs one queue type for all producer/consumer setups, make(capacity) creates a fresh queue.
+  template<typename T, typename Q, typename F>
+  void run_all (const options& opt, const std::string& name, const std::string& capacity, F make,
+                bool single_producer_consumer = false) {
+    const std::size_t n = opt.threads;
+    const std::pair<std::size_t, std::size_t> setups[] = {{1, 1}, {n, 1}, {1, n}, {n, n}};
+    for (const auto& pc : setups) {
+      if (single_producer_consumer && ((pc.first > 1) || (pc.second > 1))) {
+        continue;
+      }
+      std::unique_ptr<Q> q = make();
+      const result r = run<T>(*q, opt.items, pc.first, pc.second);
+      print(opt, {name, capacity, sizeof(T), pc.first, pc.second}, r);
+    }
+  }
+
+  // --------------------------------------------------------------------------
+  template<typename T>
+  void run_payload (const options& opt) {
+    const std::size_t small_capacity = 64;
+    const std::size_t large_capacity = 65536;
+
+    run_all<T, util::blocking_queue<T>>(opt, "blocking_queue", "unbounded", [] () {
+      return std::make_unique<util::blocking_queue<T>>();
+    });
+    run_all<T, util::sharded_queue<T>>(opt, "sharded_queue", "unbounded", [] () {
+      return std::make_unique<util::sharded_queue<T>>();
+    });
+    run_all<T, util::priority_blocking_queue<T>>(opt, "priority_blocking_queue", "unbounded", [] () {
+      return std::make_unique<util::priority_blocking_queue<T>>(1);
+    });
+
+    for (std::size_t capacity : {small_capacity, large_capacity}) {
+      const std::string cap = std::to_string(capacity);
+      run_all<T, util::bounded_queue<T>>(opt, "bounded_queue", cap, [capacity] () {
+        return std::make_unique<util::bounded_queue<T>>(capacity);
+      });
+      run_all<T, util::mpmc_queue<T>>(opt, "mpmc_queue", cap, [capacity] () {
+        return std::make_unique<util::mpmc_queue<T>>(capacity);
+      });
+      run_all<T, util::spsc_queue<T>>(opt, "spsc_queue", cap, [capacity] () {
+        return std::make_unique<util::spsc_queue<T>>(capacity);
+      }, true);
+    }
+  }
+
+} // namespace
+
+// --------------------------------------------------------------------------
+int main (int argc, const char* argv[]) {
+  options opt;
+  for (int i = 1; i < argc; ++i) {
+    if ((std::strcmp(argv[i], "--items") == 0) && (i + 1 < argc)) {
+      opt.items = std::max<std::size_t>(std::stoul(argv[++i]), 1);
+    } else if ((std::strcmp(argv[i], "--threads") == 0) && (i + 1 < argc)) {
+      opt.threads = std::max<std::size_t>(std::stoul(argv[++i]), 1);
+    } else if (std::strcmp(argv[i], "--json") == 0) {
+      opt.json = true;
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--items n] [--threads n] [--json]" << std::endl;
+      return 1;
+    }
+  }
+
+  print_header(opt);
+  run_payload<payload<16>>(opt);
+  run_payload<payload<512>>(opt);
+  return 0;
+}
@@ -20,109 +20,155 @@
 //
 // Common includes
 //
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
+#include <optional>
 #include <queue>
 #if defined USE_MINGW && __MINGW_GCC_VERSION < 100000
 #include <mingw/mingw.condition_variable.h>
 #include <mingw/mingw.mutex.h>
 #endif
 
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/queue_metrics.h>
+#include <util/wait_strategy.h>
+
 
 namespace util {
 
-  template<typename T, std:: size_t S = 0xffffffff / sizeof(T)>
+  /**
+   * Queue protected by a mutex, dequeuers wait on a condition.
+   * If more than S items are enqueued, the oldest are dropped.
+   * With a spinning wait strategy W, a dequeuer busy waits for an item before it parks
+   * and enqueuers only signal the condition, when somebody is parked.
+   * The instrumentation policy M is called for each change, queue_metrics enables stats().
+   */
+  template<typename T, std:: size_t S = 0xffffffff / sizeof(T), typename W = park_wait, typename M = no_metrics>
   class blocking_queue {
   public:
 
     /// Enqueue an item and send signal to a waiting dequeuer.
-    void enqueue (const T& t) {
-      {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_queue.size() == S) {
-          m_queue.pop();
-        }
-        m_queue.push(t);
-      }
-      m_condition.notify_all();
+    /// @return false if the queue is closed and the item was discarded.
+    bool enqueue (const T& t) {
+      return emplace(t);
     }
 
     /// Enqueue an item and send signal to a waiting dequeuer.
-    void enqueue (T&& t) {
-      {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_queue.size() == S) {
-          m_queue.pop();
-        }
-        m_queue.push(std::move(t));
+    /// @return false if the queue is closed and the item was discarded.
+    bool enqueue (T&& t) {
+      return emplace(std::move(t));
+    }
+
+    /// Construct an item in the queue and send signal to a waiting dequeuer.
+    /// @return false if the queue is closed and no item was constructed.
+    template<typename ... Args>
+    bool emplace (Args&& ... args) {
+      std::unique_lock<std::mutex> lock = acquire();
+      if (m_closed) {
+        return false;
       }
-      m_condition.notify_all();
+      if (m_queue.size() == S) {
+        m_queue.pop();
+        m_metrics.on_discard(1);
+      }
+      m_queue.emplace(std::forward<Args>(args)...);
+      m_metrics.on_enqueue(m_queue.size());
+      notify_waiters(lock);
+      return true;
     }
 
+    /// @return false if the queue is closed and the items were discarded.
     template<typename I>
-    void enqueue (I i, I end) {
-      {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        for (; i != end; ++i) {
-          if (m_queue.size() == S) {
-            m_queue.pop();
-          }
-          m_queue.push(*i);
+    bool enqueue (I i, I end) {
+      std::unique_lock<std::mutex> lock = acquire();
+      if (m_closed) {
+        return false;
+      }
+      for (; i != end; ++i) {
+        if (m_queue.size() == S) {
+          m_queue.pop();
+          m_metrics.on_discard(1);
         }
+        m_queue.push(*i);
+        m_metrics.on_enqueue(m_queue.size());
       }
-      m_condition.notify_all();
+      notify_waiters(lock);
+      return true;
     }
 
     void wait_until_empty (const std::chrono::milliseconds& timeout) {
-      std::unique_lock<std::mutex> lock(m_mutex);
-
+      std::unique_lock<std::mutex> lock = acquire();
+      ++m_sleepers;
       m_condition.wait_for(lock, timeout, [this] () {
         return m_queue.empty();
       });
+      --m_sleepers;
     }
 
     void wait_until_not_empty (std::unique_lock<std::mutex> &lock,
                                const std::chrono::milliseconds maxWait) {
+      if (!m_queue.empty() || m_closed) {
+        return;
+      }
+      const auto start = idle_start();
+      spin(lock);
+      ++m_sleepers;
       m_condition.wait_for(lock, maxWait, [this] () -> bool {
-        return !m_queue.empty();
+        return !m_queue.empty() || m_closed;
       });
+      --m_sleepers;
+      idle_end(start);
     }
 
     void wait_until_not_empty (const std::chrono::milliseconds maxWait) {
-      std::unique_lock<std::mutex> lock(m_mutex);
+      std::unique_lock<std::mutex> lock = acquire();
       wait_until_not_empty(lock, maxWait);
     }
 
     void wait_until_not_empty (std::unique_lock<std::mutex> &lock) {
+      if (!m_queue.empty() || m_closed) {
+        return;
+      }
+      const auto start = idle_start();
+      spin(lock);
+      ++m_sleepers;
       m_condition.wait(lock, [this] () -> bool {
-        return !m_queue.empty();
+        return !m_queue.empty() || m_closed;
       });
+      --m_sleepers;
+      idle_end(start);
     }
 
     void wait_until_not_empty () {
-      std::unique_lock<std::mutex> lock(m_mutex);
+      std::unique_lock<std::mutex> lock = acquire();
       wait_until_not_empty(lock);
     }
 
     /// Dequeue the last item, if available, else waits until a new item is enqueued, clear queue after pop.
     T dequeue_back (const std::chrono::milliseconds maxWait) {
-      std::unique_lock<std::mutex> lock(m_mutex);
+      std::unique_lock<std::mutex> lock = acquire();
       wait_until_not_empty(lock, maxWait);
 
       if (m_queue.empty()) {
         return T();
       }
 
-      T item = m_queue.back();
+      T item = std::move(m_queue.back());
+      m_metrics.on_discard_back(m_queue.size() - 1);
       std::queue<T> tmp;
       m_queue.swap(tmp); // clear
+      update_ready();
       m_condition.notify_all();
       return item;
     }
 
-    /// Dequeue an item if available, else waits until a new imitemage is enqueued.
+    /// Dequeue an item if available, else waits until a new item is enqueued.
     T dequeue (const std::chrono::milliseconds maxWait) {
-      std::unique_lock<std::mutex> lock(m_mutex);
+      std::unique_lock<std::mutex> lock = acquire();
 
       wait_until_not_empty(lock, maxWait);
 
@@ -130,15 +176,12 @@ namespace util {
         return T();
       }
 
-      T item = m_queue.front();
-      m_queue.pop();
-      m_condition.notify_all();
-      return item;
+      return take_item();
     }
 
     /// Dequeue the last item, if available, else waits until a new item is enqueued, clear queue after pop.
     T dequeue_back () {
-      std::unique_lock<std::mutex> lock(m_mutex);
+      std::unique_lock<std::mutex> lock = acquire();
 
       wait_until_not_empty(lock);
 
@@ -146,16 +189,18 @@ namespace util {
         return T();
       }
 
-      T item = m_queue.back();
+      T item = std::move(m_queue.back());
+      m_metrics.on_discard_back(m_queue.size() - 1);
       std::queue<T> tmp;
       m_queue.swap(tmp); // clear
+      update_ready();
       m_condition.notify_all();
       return item;
     }
 
     /// Dequeue an item if available, else waits until a new item is enqueued.
     T dequeue () {
-      std::unique_lock<std::mutex> lock(m_mutex);
+      std::unique_lock<std::mutex> lock = acquire();
 
       wait_until_not_empty(lock);
 
@@ -163,55 +208,236 @@ namespace util {
         return T();
       }
 
-      T item = m_queue.front();
-      m_queue.pop();
-      m_condition.notify_all();
-      return item;
+      return take_item();
     }
 
     /// Dequeue an item if available and return true, else return false.
     bool try_dequeue (T& t) {
-      std::unique_lock<std::mutex> lock(m_mutex);
+      std::unique_lock<std::mutex> lock = acquire();
 
       if (m_queue.empty()) {
         return false;
       }
 
-      t = m_queue.front();
-      m_queue.pop();
-      m_condition.notify_all();
+      t = take_item();
       return true;
     }
 
+    /// Dequeue an item if available, else waits until a new item is enqueued or the queue is closed.
+    /// @return the item, or nothing if the queue is closed and drained.
+    std::optional<T> pop () {
+      std::unique_lock<std::mutex> lock = acquire();
+      wait_until_not_empty(lock);
+      return take_front();
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued or the queue is closed.
+    /// @return the item, or nothing on timeout or if the queue is closed and drained.
+    std::optional<T> pop (const std::chrono::milliseconds maxWait) {
+      std::unique_lock<std::mutex> lock = acquire();
+      wait_until_not_empty(lock, maxWait);
+      return take_front();
+    }
+
+    /// @return the next item, or nothing if the queue is empty.
+    std::optional<T> try_pop () {
+      std::unique_lock<std::mutex> lock = acquire();
+      return take_front();
+    }
+
+    /// Dequeue up to max_n items with one lock, waits until an item is available or maxWait is reached.
+    /// @return the number of items written to out.
+    template<typename O>
+    std::size_t dequeue_bulk (O out, std::size_t max_n, const std::chrono::milliseconds maxWait) {
+      std::unique_lock<std::mutex> lock = acquire();
+      wait_until_not_empty(lock, maxWait);
+      return take(out, max_n);
+    }
+
+    /// Dequeue up to max_n items with one lock, waits until an item is available.
+    /// @return the number of items written to out.
+    template<typename O>
+    std::size_t dequeue_bulk (O out, std::size_t max_n) {
+      std::unique_lock<std::mutex> lock = acquire();
+      wait_until_not_empty(lock);
+      return take(out, max_n);
+    }
+
+    /// Dequeue up to max_n available items with one lock, does not wait.
+    /// @return the number of items written to out.
+    template<typename O>
+    std::size_t try_dequeue_bulk (O out, std::size_t max_n) {
+      std::unique_lock<std::mutex> lock = acquire();
+      return take(out, max_n);
+    }
+
     /// @return true, if the queue is empty.
     bool isEmpty () const {
-      std::unique_lock<std::mutex> lock(m_mutex);
+      std::unique_lock<std::mutex> lock = acquire();
       return m_queue.empty();
     }
 
     /// @return size of the queue.
     std::size_t size () const {
-      std::unique_lock<std::mutex> lock(m_mutex);
+      std::unique_lock<std::mutex> lock = acquire();
       return m_queue.size();
     }
 
     /// Removes all items from the queue.
     void clear () {
-      std::unique_lock<std::mutex> lock(m_mutex);
+      std::unique_lock<std::mutex> lock = acquire();
+      m_metrics.on_discard(m_queue.size());
       std::queue<T> tmp;
       m_queue.swap(tmp); // clear
+      update_ready();
       m_condition.notify_all();
     }
 
     void stop_waiters () {
-      std::unique_lock<std::mutex> lock(m_mutex);
+      std::unique_lock<std::mutex> lock = acquire();
       m_condition.notify_all();
     }
 
+    /// Rejects further items and wakes all waiters. Items already queued can still be dequeued,
+    /// pop returns nothing once they are drained.
+    void close () {
+      {
+        std::unique_lock<std::mutex> lock = acquire();
+        m_closed = true;
+        update_ready();
+      }
+      m_condition.notify_all();
+    }
+
+    /// @return true, if close was called.
+    bool is_closed () const {
+      std::unique_lock<std::mutex> lock = acquire();
+      return m_closed;
+    }
+
+    /// @return a copy of the counters, only available with queue_metrics.
+    queue_stats stats () const {
+      static_assert(M::enabled, "blocking_queue::stats needs an instrumentation policy like queue_metrics");
+      std::unique_lock<std::mutex> lock(m_mutex);
+      return m_metrics.snapshot();
+    }
+
+    /// Restarts the counters, only available with queue_metrics.
+    void reset_stats () {
+      static_assert(M::enabled, "blocking_queue::reset_stats needs an instrumentation policy like queue_metrics");
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_metrics.reset();
+    }
+
   private:
+    /// Locks the mutex, with metrics a failed try_lock counts as contention.
+    std::unique_lock<std::mutex> acquire () const {
+      if (M::enabled) {
+        std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+        const bool contended = !lock.owns_lock();
+        if (contended) {
+          lock.lock();
+        }
+        m_metrics.on_lock(contended);
+        return lock;
+      }
+      return std::unique_lock<std::mutex>(m_mutex);
+    }
+
+    /// The queue must not be empty.
+    T take_item () {
+      T item = std::move(m_queue.front());
+      m_queue.pop();
+      m_metrics.on_dequeue();
+      notify_if_empty();
+      return item;
+    }
+
+    /// Only waiters for an empty queue are interested in a dequeue.
+    void notify_if_empty () {
+      if (m_queue.empty()) {
+        update_ready();
+        if (m_sleepers > 0) {
+          m_condition.notify_all();
+        }
+      }
+    }
+
+    /// Signals new items after the lock is released, skipped if nobody is parked.
+    void notify_waiters (std::unique_lock<std::mutex>& lock) {
+      update_ready();
+      const bool parked = m_sleepers > 0;
+      lock.unlock();
+      if (parked) {
+        m_condition.notify_all();
+      }
+    }
+
+    /// Keeps the lock free flag for spinning dequeuers up to date, the lock must be held.
+    void update_ready () {
+      if (is_spinning<W>()) {
+        m_ready.store(!m_queue.empty() || m_closed, std::memory_order_release);
+      }
+    }
+
+    queue_stats::clock::time_point idle_start () const {
+      return M::enabled ? queue_stats::clock::now() : queue_stats::clock::time_point();
+    }
+
+    void idle_end (queue_stats::clock::time_point start) {
+      if (M::enabled) {
+        m_metrics.on_idle(queue_stats::clock::now() - start);
+      }
+    }
+
+    /// Busy waits without the lock until an item is available or the spin phase of W is over.
+    void spin (std::unique_lock<std::mutex>& lock) {
+      if (is_spinning<W>() && m_queue.empty() && !m_closed) {
+        lock.unlock();
+        spin_until<W>([this] () {
+          return m_ready.load(std::memory_order_acquire);
+        });
+        lock.lock();
+      }
+    }
+
+    std::optional<T> take_front () {
+      if (m_queue.empty()) {
+        return std::nullopt;
+      }
+      return take_item();
+    }
+
+    template<typename O>
+    std::size_t take (O& out, std::size_t max_n) {
+      std::size_t n = 0;
+      for (; (n < max_n) && !m_queue.empty(); ++n) {
+        *out = std::move(m_queue.front());
+        ++out;
+        m_queue.pop();
+        m_metrics.on_dequeue();
+      }
+      if (n > 0) {
+        notify_if_empty();
+      }
+      return n;
+    }
+
     /// The queue to store the items in.
     std::queue<T> m_queue;
 
+    /// Set by close, no further items are accepted.
+    bool m_closed = false;
+
+    /// Instrumentation policy, guarded by m_mutex.
+    mutable M m_metrics;
+
+    /// Number of threads waiting on the condition.
+    std::size_t m_sleepers = 0;
+
+    /// Mirrors !m_queue.empty() || m_closed for spinning dequeuers.
+    std::atomic<bool> m_ready{false};
+
     /// Condition to signal new item to dequeuer.
     std::condition_variable m_condition;
 
@@ -220,14 +446,14 @@ namespace util {
 
   };
 
-  template<typename T, std:: size_t S>
-  inline blocking_queue<T, S>& operator<< (blocking_queue<T, S>& queue, const T& t) {
+  template<typename T, std:: size_t S, typename W, typename M>
+  inline blocking_queue<T, S, W, M>& operator<< (blocking_queue<T, S, W, M>& queue, const T& t) {
     queue.enqueue(t);
     return queue;
   }
 
-  template<typename T, std:: size_t S>
-  inline blocking_queue<T, S>& operator>> (blocking_queue<T, S>& queue, T& t) {
+  template<typename T, std:: size_t S, typename W, typename M>
+  inline blocking_queue<T, S, W, M>& operator>> (blocking_queue<T, S, W, M>& queue, T& t) {
     t = queue.dequeue();
     return queue;
   }
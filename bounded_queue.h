@@ -0,0 +1,433 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: bounded blocking queue
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#if defined USE_MINGW && __MINGW_GCC_VERSION < 100000
+#include <mingw/mingw.condition_variable.h>
+#include <mingw/mingw.mutex.h>
+#endif
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/ring_buffer.h>
+
+
+namespace util {
+
+  /// What a bounded_queue does with a new item, when it is full.
+  enum class overflow {
+    /// The producer waits until a consumer makes space.
+    block,
+    /// The new item is discarded.
+    drop_newest,
+    /// The oldest item is discarded to make space.
+    drop_oldest
+  };
+
+  /**
+   * Blocking queue with preallocated ring storage of a fixed capacity.
+   * Producers and consumers wait on separate conditions.
+   */
+  template<typename T, overflow O = overflow::block>
+  class bounded_queue {
+  public:
+    explicit bounded_queue (std::size_t capacity)
+      : m_queue(capacity)
+      , m_dropped(0)
+      , m_watchers(0)
+      , m_closed(false)
+    {}
+
+    /// Enqueue an item, @return false if it was dropped.
+    bool enqueue (const T& t) {
+      return emplace(t);
+    }
+
+    /// Enqueue an item, @return false if it was dropped.
+    bool enqueue (T&& t) {
+      return emplace(std::move(t));
+    }
+
+    /// Enqueue an item, with overflow::block wait at most maxWait for space. @return false if it was not stored.
+    bool enqueue (const T& t, const std::chrono::milliseconds maxWait) {
+      return emplace_for(maxWait, t);
+    }
+
+    /// Enqueue an item, with overflow::block wait at most maxWait for space. @return false if it was not stored.
+    bool enqueue (T&& t, const std::chrono::milliseconds maxWait) {
+      return emplace_for(maxWait, std::move(t));
+    }
+
+    /// Enqueue an item without waiting. @return false if it was not stored.
+    bool try_enqueue (const T& t) {
+      return emplace_for(std::chrono::milliseconds(0), t);
+    }
+
+    /// Enqueue an item without waiting. @return false if it was not stored.
+    bool try_enqueue (T&& t) {
+      return emplace_for(std::chrono::milliseconds(0), std::move(t));
+    }
+
+    /// Construct an item in the queue, @return false if it was dropped or the queue is closed.
+    template<typename ... Args>
+    bool emplace (Args&& ... args) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (O == overflow::block) {
+        m_not_full.wait(lock, [this] () {
+          return !m_queue.full() || m_closed;
+        });
+      }
+      if (m_closed) {
+        return false;
+      }
+      return push(lock, std::forward<Args>(args)...);
+    }
+
+    /// Enqueue all items with one lock, each one like enqueue. @return false if the queue is closed.
+    template<typename I>
+    bool enqueue (I i, I end) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      std::size_t n = 0;
+      for (; i != end; ++i) {
+        if ((O == overflow::block) && m_queue.full() && !m_closed) {
+          // let consumers make space for the rest
+          filled(lock, n);
+          n = 0;
+          lock.lock();
+          m_not_full.wait(lock, [this] () {
+            return !m_queue.full() || m_closed;
+          });
+        }
+        if (m_closed) {
+          filled(lock, n);
+          return false;
+        }
+        n += store(*i);
+      }
+      filled(lock, n);
+      return true;
+    }
+
+    void wait_until_empty (const std::chrono::milliseconds& timeout) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_empty.wait_for(lock, timeout, [this] () {
+        return m_queue.empty();
+      });
+    }
+
+    void wait_until_not_empty (const std::chrono::milliseconds maxWait) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      ++m_watchers;
+      m_filled.wait_for(lock, maxWait, [this] () {
+        return !m_queue.empty() || m_closed;
+      });
+      --m_watchers;
+    }
+
+    void wait_until_not_empty () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      ++m_watchers;
+      m_filled.wait(lock, [this] () {
+        return !m_queue.empty() || m_closed;
+      });
+      --m_watchers;
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued, return T() on timeout.
+    T dequeue (const std::chrono::milliseconds maxWait) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_not_empty.wait_for(lock, maxWait, [this] () {
+        return !m_queue.empty() || m_closed;
+      });
+      if (m_queue.empty()) {
+        return T();
+      }
+      return take_front(lock);
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued, return T() if closed and drained.
+    T dequeue () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_not_empty.wait(lock, [this] () {
+        return !m_queue.empty() || m_closed;
+      });
+      if (m_queue.empty()) {
+        return T();
+      }
+      return take_front(lock);
+    }
+
+    /// Dequeue an item if available and return true, else return false.
+    bool try_dequeue (T& t) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (m_queue.empty()) {
+        return false;
+      }
+      t = take_front(lock);
+      return true;
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued or the queue is closed.
+    /// @return the item, or nothing if the queue is closed and drained.
+    std::optional<T> pop () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_not_empty.wait(lock, [this] () {
+        return !m_queue.empty() || m_closed;
+      });
+      if (m_queue.empty()) {
+        return std::nullopt;
+      }
+      return take_front(lock);
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued or the queue is closed.
+    /// @return the item, or nothing on timeout or if the queue is closed and drained.
+    std::optional<T> pop (const std::chrono::milliseconds maxWait) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_not_empty.wait_for(lock, maxWait, [this] () {
+        return !m_queue.empty() || m_closed;
+      });
+      if (m_queue.empty()) {
+        return std::nullopt;
+      }
+      return take_front(lock);
+    }
+
+    /// @return the next item, or nothing if the queue is empty.
+    std::optional<T> try_pop () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (m_queue.empty()) {
+        return std::nullopt;
+      }
+      return take_front(lock);
+    }
+
+    /// Dequeue up to max_n items with one lock, waits until an item is available or maxWait is reached.
+    /// @return the number of items written to out.
+    template<typename I>
+    std::size_t dequeue_bulk (I out, std::size_t max_n, const std::chrono::milliseconds maxWait) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_not_empty.wait_for(lock, maxWait, [this] () {
+        return !m_queue.empty() || m_closed;
+      });
+      return take(lock, out, max_n);
+    }
+
+    /// Dequeue up to max_n items with one lock, waits until an item is available.
+    template<typename I>
+    std::size_t dequeue_bulk (I out, std::size_t max_n) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_not_empty.wait(lock, [this] () {
+        return !m_queue.empty() || m_closed;
+      });
+      return take(lock, out, max_n);
+    }
+
+    /// Dequeue up to max_n available items with one lock, does not wait.
+    template<typename I>
+    std::size_t try_dequeue_bulk (I out, std::size_t max_n) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      return take(lock, out, max_n);
+    }
+
+    /// @return true, if the queue is empty.
+    bool isEmpty () const {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      return m_queue.empty();
+    }
+
+    /// @return size of the queue.
+    std::size_t size () const {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      return m_queue.size();
+    }
+
+    std::size_t capacity () const {
+      return m_queue.capacity();
+    }
+
+    /// @return the number of items dropped because the queue was full.
+    std::size_t dropped () const {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      return m_dropped;
+    }
+
+    /// Removes all items from the queue.
+    void clear () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_queue.clear();
+      m_not_full.notify_all();
+      m_empty.notify_all();
+    }
+
+    void stop_waiters () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_not_empty.notify_all();
+      m_filled.notify_all();
+      m_not_full.notify_all();
+      m_empty.notify_all();
+    }
+
+    /// Rejects further items and wakes all waiters. Blocked producers return false,
+    /// items already queued can still be dequeued, pop returns nothing once they are drained.
+    void close () {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+      }
+      m_not_empty.notify_all();
+      m_filled.notify_all();
+      m_not_full.notify_all();
+    }
+
+    /// @return true, if close was called.
+    bool is_closed () const {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      return m_closed;
+    }
+
+  private:
+    template<typename ... Args>
+    bool emplace_for (const std::chrono::milliseconds maxWait, Args&& ... args) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (O == overflow::block) {
+        m_not_full.wait_for(lock, maxWait, [this] () {
+          return !m_queue.full() || m_closed;
+        });
+        if (m_queue.full()) {
+          return false;
+        }
+      }
+      if (m_closed) {
+        return false;
+      }
+      return push(lock, std::forward<Args>(args)...);
+    }
+
+    /// With overflow::block the queue must not be full.
+    template<typename ... Args>
+    bool push (std::unique_lock<std::mutex>& lock, Args&& ... args) {
+      if (!store(std::forward<Args>(args)...)) {
+        return false;
+      }
+      filled(lock, 1);
+      return true;
+    }
+
+    /// Stores an item, drops one on overflow. @return false if the new item was dropped.
+    template<typename ... Args>
+    bool store (Args&& ... args) {
+      if (m_queue.full()) {
+        ++m_dropped;
+        if (O == overflow::drop_newest) {
+          return false;
+        }
+        m_queue.pop_front();
+      }
+      m_queue.emplace_back(std::forward<Args>(args)...);
+      return true;
+    }
+
+    /// Unlocks and wakes a consumer for each of n new items, and all wait_until_not_empty callers.
+    void filled (std::unique_lock<std::mutex>& lock, std::size_t n) {
+      const bool watched = (n > 0) && (m_watchers > 0);
+      lock.unlock();
+      if (n == 1) {
+        m_not_empty.notify_one();
+      } else if (n > 1) {
+        m_not_empty.notify_all();
+      }
+      if (watched) {
+        m_filled.notify_all();
+      }
+    }
+
+    T take_front (std::unique_lock<std::mutex>& lock) {
+      T item = std::move(m_queue.front());
+      m_queue.pop_front();
+      const bool empty = m_queue.empty();
+      lock.unlock();
+      if (O == overflow::block) {
+        m_not_full.notify_one();
+      }
+      if (empty) {
+        m_empty.notify_all();
+      }
+      return item;
+    }
+
+    template<typename I>
+    std::size_t take (std::unique_lock<std::mutex>& lock, I& out, std::size_t max_n) {
+      std::size_t n = 0;
+      for (; (n < max_n) && !m_queue.empty(); ++n) {
+        *out = std::move(m_queue.front());
+        ++out;
+        m_queue.pop_front();
+      }
+      const bool empty = m_queue.empty();
+      lock.unlock();
+      if ((O == overflow::block) && (n > 1)) {
+        m_not_full.notify_all();
+      } else if ((O == overflow::block) && (n == 1)) {
+        m_not_full.notify_one();
+      }
+      if (empty && (n > 0)) {
+        m_empty.notify_all();
+      }
+      return n;
+    }
+
+    /// The preallocated storage of the items.
+    ring_buffer<T> m_queue;
+
+    /// Number of items dropped on overflow.
+    std::size_t m_dropped;
+
+    /// Number of threads in wait_until_not_empty.
+    std::size_t m_watchers;
+
+    /// Set by close, no further items are accepted.
+    bool m_closed;
+
+    /// Condition to signal new item to dequeuer.
+    std::condition_variable m_not_empty;
+
+    /// Condition to signal new items to wait_until_not_empty, that takes none.
+    std::condition_variable m_filled;
+
+    /// Condition to signal free space to blocked producers.
+    std::condition_variable m_not_full;
+
+    /// Condition to signal an empty queue to wait_until_empty.
+    std::condition_variable m_empty;
+
+    /// Mutex for thread safe access to the queue.
+    mutable std::mutex m_mutex;
+
+  };
+
+} // namespace util
@@ -0,0 +1,313 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: bounded channel for C++20 coroutines
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define UTIL_HAS_COROUTINES 1
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+#if defined USE_MINGW && __MINGW_GCC_VERSION < 100000
+#include <mingw/mingw.mutex.h>
+#endif
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/ring_buffer.h>
+#include <util/thread_pool.h>
+
+
+namespace util {
+
+  /**
+   * Coroutine type for fire and forget coroutines, it starts immediately
+   * and frees its frame when it finishes.
+   */
+  struct detached_task {
+    struct promise_type {
+      detached_task get_return_object () noexcept {
+        return {};
+      }
+
+      std::suspend_never initial_suspend () noexcept {
+        return {};
+      }
+
+      std::suspend_never final_suspend () noexcept {
+        return {};
+      }
+
+      void return_void () noexcept {}
+
+      void unhandled_exception () noexcept {
+        std::terminate();
+      }
+    };
+  };
+
+  /**
+   * Bounded fifo between coroutines. co_await send(v) suspends while the channel is full,
+   * co_await receive() suspends while it is empty. Suspended coroutines are resumed
+   * through the executor, never inline in the partner that made them ready.
+   * Plain threads can take part with try_send and try_receive.
+   */
+  template<typename T>
+  class channel {
+  public:
+    typedef std::function<void(std::coroutine_handle<>)> executor;
+
+    channel (std::size_t capacity, executor ex)
+      : m_buffer(capacity)
+      , m_executor(std::move(ex))
+      , m_closed(false)
+    {}
+
+    /// Resumes suspended coroutines on the workers of pool.
+    channel (std::size_t capacity, thread_pool& pool)
+      : channel(capacity, [&pool] (std::coroutine_handle<> h) {
+          pool.execute([h] () {
+            h.resume();
+          });
+        })
+    {}
+
+    channel (const channel&) = delete;
+    channel& operator= (const channel&) = delete;
+
+    class send_awaiter;
+    class receive_awaiter;
+
+    /// co_await send(v) suspends while the channel is full, it results in false if the channel is closed.
+    send_awaiter send (T t) {
+      return send_awaiter(*this, std::move(t));
+    }
+
+    /// co_await receive() suspends while the channel is empty, it results in nothing if the channel is closed and drained.
+    receive_awaiter receive () {
+      return receive_awaiter(*this);
+    }
+
+    /// Sends without suspending. @return false if the channel is full or closed.
+    bool try_send (T t) {
+      std::coroutine_handle<> wake;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed || m_buffer.full()) {
+          return false;
+        }
+        wake = put(std::move(t));
+      }
+      schedule(wake);
+      return true;
+    }
+
+    /// Receives without suspending. @return nothing if the channel is empty.
+    std::optional<T> try_receive () {
+      std::optional<T> t;
+      std::coroutine_handle<> wake;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        wake = take(t);
+      }
+      schedule(wake);
+      return t;
+    }
+
+    /// Rejects further items and resumes all suspended coroutines. Buffered items can still be received.
+    void close () {
+      std::vector<std::coroutine_handle<>> wake;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        for (receive_awaiter* r : m_receivers) {
+          wake.push_back(r->m_handle);
+        }
+        m_receivers.clear();
+        for (send_awaiter* s : m_senders) {
+          s->m_sent = false;
+          wake.push_back(s->m_handle);
+        }
+        m_senders.clear();
+      }
+      for (auto h : wake) {
+        schedule(h);
+      }
+    }
+
+    bool is_closed () const {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_closed;
+    }
+
+    /// @return the number of buffered items.
+    std::size_t size () const {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_buffer.size();
+    }
+
+    std::size_t capacity () const {
+      return m_buffer.capacity();
+    }
+
+    // --------------------------------------------------------------------------
+    class send_awaiter {
+    public:
+      send_awaiter (channel& c, T&& t)
+        : m_channel(c)
+        , m_value(std::move(t))
+        , m_sent(false)
+      {}
+
+      bool await_ready () const noexcept {
+        return false;
+      }
+
+      bool await_suspend (std::coroutine_handle<> h) {
+        std::coroutine_handle<> wake;
+        {
+          std::lock_guard<std::mutex> lock(m_channel.m_mutex);
+          if (m_channel.m_closed) {
+            return false;
+          }
+          if (m_channel.m_buffer.full()) {
+            m_handle = h;
+            m_channel.m_senders.push_back(this);
+            return true; // may be resumed by another thread from now on
+          }
+          wake = m_channel.put(std::move(m_value));
+          m_sent = true;
+        }
+        m_channel.schedule(wake);
+        return false;
+      }
+
+      /// @return false if the channel was closed.
+      bool await_resume () const noexcept {
+        return m_sent;
+      }
+
+    private:
+      friend class channel;
+
+      channel& m_channel;
+      T m_value;
+      bool m_sent;
+      std::coroutine_handle<> m_handle;
+    };
+
+    // --------------------------------------------------------------------------
+    class receive_awaiter {
+    public:
+      explicit receive_awaiter (channel& c)
+        : m_channel(c)
+      {}
+
+      bool await_ready () const noexcept {
+        return false;
+      }
+
+      bool await_suspend (std::coroutine_handle<> h) {
+        std::coroutine_handle<> wake;
+        {
+          std::lock_guard<std::mutex> lock(m_channel.m_mutex);
+          if (m_channel.m_buffer.empty() && !m_channel.m_closed) {
+            m_handle = h;
+            m_channel.m_receivers.push_back(this);
+            return true; // may be resumed by another thread from now on
+          }
+          wake = m_channel.take(m_value);
+        }
+        m_channel.schedule(wake);
+        return false;
+      }
+
+      /// @return the item, or nothing if the channel is closed and drained.
+      std::optional<T> await_resume () noexcept {
+        return std::move(m_value);
+      }
+
+    private:
+      friend class channel;
+
+      channel& m_channel;
+      std::optional<T> m_value;
+      std::coroutine_handle<> m_handle;
+    };
+
+  private:
+    /// Hands t to a waiting receiver or buffers it, the buffer must not be full.
+    /// @return the receiver to resume.
+    std::coroutine_handle<> put (T&& t) {
+      if (!m_receivers.empty()) {
+        receive_awaiter* r = m_receivers.front();
+        m_receivers.pop_front();
+        r->m_value.emplace(std::move(t));
+        return r->m_handle;
+      }
+      m_buffer.emplace_back(std::move(t));
+      return {};
+    }
+
+    /// Takes the oldest item, refills the buffer from a waiting sender.
+    /// @return the sender to resume.
+    std::coroutine_handle<> take (std::optional<T>& t) {
+      if (m_buffer.empty()) {
+        return {};
+      }
+      t.emplace(std::move(m_buffer.front()));
+      m_buffer.pop_front();
+      if (!m_senders.empty()) {
+        send_awaiter* s = m_senders.front();
+        m_senders.pop_front();
+        m_buffer.emplace_back(std::move(s->m_value));
+        s->m_sent = true;
+        return s->m_handle;
+      }
+      return {};
+    }
+
+    void schedule (std::coroutine_handle<> h) {
+      if (h) {
+        m_executor(h);
+      }
+    }
+
+    ring_buffer<T> m_buffer;
+    executor m_executor;
+    bool m_closed;
+
+    /// Suspended coroutines in fifo order.
+    std::deque<send_awaiter*> m_senders;
+    std::deque<receive_awaiter*> m_receivers;
+
+    mutable std::mutex m_mutex;
+  };
+
+} // namespace util
+
+#endif // __cpp_impl_coroutine
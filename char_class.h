@@ -0,0 +1,205 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: character classes and search for their members
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <cstdint>
+#include <string_view>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+// The block search is built for SSSE3 in any case and used if the cpu has it.
+#define UTIL_CHAR_CLASS_SSSE3 1
+#define UTIL_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+
+
+namespace util {
+
+  /**
+   * Set of chars as a 256 bit map, usually built at compile time:
+   *
+   * constexpr util::char_class digits("0123456789");
+   *
+   * For classes of ascii chars only, a nibble table is kept as well, that lets
+   * the find functions test 16 chars at once with SSSE3 shuffles on x86 cpus that have them,
+   * checked at runtime. Otherwise and for other classes they test char by char in the map.
+   */
+  class char_class {
+  public:
+    constexpr explicit char_class (std::string_view chars)
+      : m_bits{0, 0, 0, 0}
+      , m_nibbles{}
+      , m_ascii(true)
+    {
+      for (char ch : chars) {
+        const unsigned char c = static_cast<unsigned char>(ch);
+        m_bits[c >> 6] |= std::uint64_t(1) << (c & 63);
+        if (c < 0x80) {
+          m_nibbles[c & 0x0f] = static_cast<std::uint8_t>(m_nibbles[c & 0x0f] | (1 << (c >> 4)));
+        } else {
+          m_ascii = false;
+        }
+      }
+    }
+
+    constexpr bool contains (char ch) const {
+      const unsigned char c = static_cast<unsigned char>(ch);
+      return (m_bits[c >> 6] >> (c & 63)) & 1;
+    }
+
+    constexpr bool operator() (char ch) const {
+      return contains(ch);
+    }
+
+    /// @return true, if all members are ascii chars and the nibble table is complete.
+    constexpr bool is_ascii () const {
+      return m_ascii;
+    }
+
+#if defined(UTIL_CHAR_CLASS_SSSE3)
+    /// @return a bit for each of the 16 chars at p, set if the char is a member. Only for ascii classes,
+    /// only on cpus with SSSE3, see detail::has_ssse3().
+    UTIL_TARGET_SSSE3 unsigned members16 (const char* p) const {
+      const __m128i low_mask = _mm_set1_epi8(0x0f);
+      const __m128i high_bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+      const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_nibbles));
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      const __m128i rows = _mm_shuffle_epi8(table, _mm_and_si128(v, low_mask));
+      const __m128i cols = _mm_shuffle_epi8(high_bits, _mm_and_si128(_mm_srli_epi16(v, 4), low_mask));
+      const __m128i outside = _mm_cmpeq_epi8(_mm_and_si128(rows, cols), _mm_setzero_si128());
+      return ~static_cast<unsigned>(_mm_movemask_epi8(outside)) & 0xffff;
+    }
+#endif
+
+  private:
+    std::uint64_t m_bits[4];
+    /// For each low nibble a bit per high nibble 0-7 of the ascii members.
+    std::uint8_t m_nibbles[16];
+    bool m_ascii;
+  };
+
+  namespace detail {
+
+    template<bool Member>
+    std::size_t scalar_find_first (std::string_view s, const char_class& c, std::size_t pos) {
+      for (; pos < s.size(); ++pos) {
+        if (c.contains(s[pos]) == Member) {
+          return pos;
+        }
+      }
+      return std::string_view::npos;
+    }
+
+    /// Searches [0, end) backwards.
+    template<bool Member>
+    std::size_t scalar_find_last (std::string_view s, const char_class& c, std::size_t end) {
+      while (end > 0) {
+        --end;
+        if (c.contains(s[end]) == Member) {
+          return end;
+        }
+      }
+      return std::string_view::npos;
+    }
+
+#if defined(UTIL_CHAR_CLASS_SSSE3)
+    inline bool has_ssse3 () {
+#if defined(__SSSE3__)
+      return true;
+#else
+      static const bool supported = __builtin_cpu_supports("ssse3");
+      return supported;
+#endif
+    }
+
+    template<bool Member>
+    UTIL_TARGET_SSSE3 std::size_t ssse3_find_first (std::string_view s, const char_class& c, std::size_t pos) {
+      for (; pos + 16 <= s.size(); pos += 16) {
+        unsigned hits = c.members16(s.data() + pos);
+        if (!Member) {
+          hits = ~hits & 0xffff;
+        }
+        if (hits) {
+          return pos + static_cast<std::size_t>(__builtin_ctz(hits));
+        }
+      }
+      return scalar_find_first<Member>(s, c, pos);
+    }
+
+    template<bool Member>
+    UTIL_TARGET_SSSE3 std::size_t ssse3_find_last (std::string_view s, const char_class& c, std::size_t end) {
+      for (; end >= 16; end -= 16) {
+        unsigned hits = c.members16(s.data() + end - 16);
+        if (!Member) {
+          hits = ~hits & 0xffff;
+        }
+        if (hits) {
+          return end - 16 + static_cast<std::size_t>(31 - __builtin_clz(hits));
+        }
+      }
+      return scalar_find_last<Member>(s, c, end);
+    }
+#endif
+
+    template<bool Member>
+    std::size_t find_first (std::string_view s, const char_class& c, std::size_t pos) {
+#if defined(UTIL_CHAR_CLASS_SSSE3)
+      if (c.is_ascii() && (pos < s.size()) && (s.size() - pos >= 16) && has_ssse3()) {
+        return ssse3_find_first<Member>(s, c, pos);
+      }
+#endif
+      return scalar_find_first<Member>(s, c, pos);
+    }
+
+    /// Searches [0, pos], like std::string::find_last_of.
+    template<bool Member>
+    std::size_t find_last (std::string_view s, const char_class& c, std::size_t pos) {
+      const std::size_t end = (pos < s.size()) ? pos + 1 : s.size();
+#if defined(UTIL_CHAR_CLASS_SSSE3)
+      if (c.is_ascii() && (end >= 16) && has_ssse3()) {
+        return ssse3_find_last<Member>(s, c, end);
+      }
+#endif
+      return scalar_find_last<Member>(s, c, end);
+    }
+
+  } // namespace detail
+
+  /// @return the position of the first member of c in s at or after pos, or npos.
+  inline std::size_t find_first_in (std::string_view s, const char_class& c, std::size_t pos = 0) {
+    return detail::find_first<true>(s, c, pos);
+  }
+
+  /// @return the position of the first char of s at or after pos that is no member of c, or npos.
+  inline std::size_t find_first_not_in (std::string_view s, const char_class& c, std::size_t pos = 0) {
+    return detail::find_first<false>(s, c, pos);
+  }
+
+  /// @return the position of the last member of c in s at or before pos, or npos.
+  inline std::size_t find_last_in (std::string_view s, const char_class& c, std::size_t pos = std::string_view::npos) {
+    return detail::find_last<true>(s, c, pos);
+  }
+
+  /// @return the position of the last char of s at or before pos that is no member of c, or npos.
+  inline std::size_t find_last_not_in (std::string_view s, const char_class& c, std::size_t pos = std::string_view::npos) {
+    return detail::find_last<false>(s, c, pos);
+  }
+
+} // namespace util
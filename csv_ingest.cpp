@@ -0,0 +1,198 @@
+/**
+ * @copyright (c) 2018-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ Impl: parallel csv file ingestion
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include "csv_ingest.h"
+#include "csv_reader.h"
+#include "fs_util.h"
+#include "ostreamfmt.h"
+
+namespace util {
+
+  namespace csv {
+
+    namespace {
+
+      // --------------------------------------------------------------------------
+      /*
+       * A part of a file, owning all rows starting in [begin, end).
+       */
+      struct chunk {
+        const sys_fs::path* file;
+        std::size_t begin;
+        std::size_t end;
+      };
+
+      // --------------------------------------------------------------------------
+      /*
+       * The chunks of one worker. The owner takes from the back, thieves take from the front.
+       */
+      struct alignas(64) work_deque {
+        bool pop (chunk& c) {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (chunks.empty()) {
+            return false;
+          }
+          c = chunks.back();
+          chunks.pop_back();
+          return true;
+        }
+
+        bool steal (chunk& c) {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (chunks.empty()) {
+            return false;
+          }
+          c = chunks.front();
+          chunks.pop_front();
+          return true;
+        }
+
+        std::deque<chunk> chunks;
+        std::mutex mutex;
+      };
+
+      // --------------------------------------------------------------------------
+      void parse_chunk (const chunk& c, char delimiter, bool ignoreFirst,
+                        const ingest_fn& fn, std::size_t worker) {
+        std::ifstream file(*c.file, std::ios::binary);
+        if (!file.is_open()) {
+          throw std::runtime_error(ostreamfmt("Could not open " << c.file->string()));
+        }
+        if (c.begin > 0) {
+          // the row starting before begin belongs to the previous chunk
+          file.seekg(c.begin - 1);
+          file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+          if (!file.good()) {
+            return;
+          }
+        }
+        const std::size_t offset = c.begin > 0 ? static_cast<std::size_t>(file.tellg()) : 0;
+
+        detail::counting_streambuf counter(file);
+        std::istream in(&counter);
+
+        bool ignore = ignoreFirst && (c.begin == 0);
+        while (in.good()) {
+          while ((in.peek() == '\n') || (in.peek() == '\r')) {
+            in.get();
+          }
+          if (!in.good() || (offset + counter.count() >= c.end)) {
+            break;
+          }
+          std::vector<std::string> line = parse_csv_line(in, delimiter);
+          if (ignore) {
+            ignore = false;
+          } else {
+            fn(line, worker);
+          }
+        }
+      }
+
+    } // namespace
+
+    // --------------------------------------------------------------------------
+    void ingest_csv_files (const std::vector<sys_fs::path>& files, char delimiter, bool ignoreFirst,
+                           const ingest_fn& fn, const ingest_options& options) {
+      const std::size_t workers = options.worker_count();
+      std::vector<work_deque> deques(workers);
+
+      // deal the chunks round robin to the workers
+      std::size_t next = 0;
+      for (const auto& file : files) {
+        const std::size_t size = static_cast<std::size_t>(sys_fs::file_size(file));
+        const std::size_t step = options.chunk_size ? options.chunk_size : size;
+        std::size_t begin = 0;
+        do {
+          const std::size_t end = (size - begin > step) ? begin + step : std::numeric_limits<std::size_t>::max();
+          deques[next++ % workers].chunks.push_back({&file, begin, end});
+          begin = end;
+        } while (begin < size);
+      }
+
+      std::atomic_bool failed(false);
+      std::mutex error_mutex;
+      std::exception_ptr error;
+
+      auto run = [&] (std::size_t worker) {
+        std::minstd_rand random(static_cast<unsigned>(worker + 1));
+        chunk c;
+        try {
+          while (!failed) {
+            if (!deques[worker].pop(c)) {
+              // steal from a random victim, give up after all others are found empty
+              bool found = false;
+              const std::size_t first = random() % workers;
+              for (std::size_t i = 0; !found && (i < workers); ++i) {
+                const std::size_t victim = (first + i) % workers;
+                found = (victim != worker) && deques[victim].steal(c);
+              }
+              if (!found) {
+                return;
+              }
+            }
+            parse_chunk(c, delimiter, ignoreFirst, fn, worker);
+          }
+        } catch (...) {
+          failed = true;
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (!error) {
+            error = std::current_exception();
+          }
+        }
+      };
+
+      std::vector<std::thread> threads;
+      threads.reserve(workers - 1);
+      for (std::size_t i = 1; i < workers; ++i) {
+        threads.emplace_back(run, i);
+      }
+      run(0);
+      for (auto& t : threads) {
+        t.join();
+      }
+
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+
+    // --------------------------------------------------------------------------
+    void ingest_csv_files (const sys_fs::path& dir, const std::string& pattern,
+                           char delimiter, bool ignoreFirst,
+                           const ingest_fn& fn, const ingest_options& options) {
+      ingest_csv_files(util::fs::find_files(dir, pattern), delimiter, ignoreFirst, fn, options);
+    }
+
+  } // namespace csv
+
+} // namespace util
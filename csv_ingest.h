@@ -0,0 +1,109 @@
+/**
+ * @copyright (c) 2018-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: parallel csv file ingestion
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <vector>
+#include <string>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/sys_fs.h>
+#include <util/util-export.h>
+
+
+namespace util {
+
+  namespace csv {
+
+    // --------------------------------------------------------------------------
+    struct ingest_options {
+      /// Number of parse threads, 0 uses std::thread::hardware_concurrency().
+      std::size_t workers = 0;
+      /**
+       * Files bigger than this are split into chunks at line ends, 0 never splits.
+       * Only split files that have no line breaks inside of quoted entries.
+       */
+      std::size_t chunk_size = 16 * 1024 * 1024;
+
+      inline std::size_t worker_count () const {
+        return workers ? workers : std::max(1U, std::thread::hardware_concurrency());
+      }
+    };
+
+    /// Called for each row with the index of the calling worker, in the range [0, worker_count()).
+    typedef std::function<void(const std::vector<std::string>&, std::size_t)> ingest_fn;
+
+    // --------------------------------------------------------------------------
+    /**
+     * Parses the files concurrently, idle workers steal chunks from the busy ones.
+     * fn is called concurrently from all workers, the rows of a chunk are passed in order.
+     * If ignoreFirst is set, the first row of each file is skipped.
+     * The first exception thrown by a worker is rethrown after all workers stopped.
+     */
+    UTIL_EXPORT void ingest_csv_files (const std::vector<sys_fs::path>& files, char delimiter, bool ignoreFirst,
+                                       const ingest_fn& fn, const ingest_options& options = {});
+
+    /// Parses all regular files in dir matching the wildcard pattern.
+    UTIL_EXPORT void ingest_csv_files (const sys_fs::path& dir, const std::string& pattern,
+                                       char delimiter, bool ignoreFirst,
+                                       const ingest_fn& fn, const ingest_options& options = {});
+
+    namespace detail {
+
+      /// A value on its own cache line, so that values of different workers in one vector do not share lines.
+      template<typename T>
+      struct alignas(64) cache_aligned {
+        T value;
+      };
+
+    } // namespace detail
+
+    // --------------------------------------------------------------------------
+    /**
+     * Parses the files with one accumulator per worker, each a copy of init.
+     * fn(T& acc, const std::vector<std::string>& row) needs no locking,
+     * merge(T& into, T&& from) joins the accumulators after all files are parsed.
+     */
+    template<typename T, typename F, typename M>
+    T ingest_csv_files (const std::vector<sys_fs::path>& files, char delimiter, bool ignoreFirst,
+                        T init, F fn, M merge, const ingest_options& options = {}) {
+      ingest_options opts = options;
+      opts.workers = options.worker_count();
+      std::vector<detail::cache_aligned<T>> accumulators(opts.workers, detail::cache_aligned<T>{init});
+      ingest_csv_files(files, delimiter, ignoreFirst, [&] (const std::vector<std::string>& row, std::size_t worker) {
+        fn(accumulators[worker].value, row);
+      }, opts);
+      T result = std::move(accumulators.front().value);
+      for (auto i = std::next(accumulators.begin()); i != accumulators.end(); ++i) {
+        merge(result, std::move(i->value));
+      }
+      return result;
+    }
+
+  } // namespace csv
+
+} // namespace util
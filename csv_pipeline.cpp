@@ -0,0 +1,266 @@
+/**
+ * @copyright (c) 2018-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ Impl: parallel csv transformation
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <thread>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include "csv_pipeline.h"
+#include "csv_reader.h"
+#include "blocking_queue.h"
+
+namespace util {
+
+  namespace csv {
+
+    namespace {
+
+      // --------------------------------------------------------------------------
+      struct batch {
+        std::size_t sequence;
+        bool header;
+        std::vector<std::vector<std::string>> rows;
+      };
+
+      typedef std::shared_ptr<batch> batch_ptr;
+
+      // --------------------------------------------------------------------------
+      /*
+       * Collects transformed batches and hands them out in sequence order.
+       * Limits the number of batches between reader and writer.
+       */
+      class reorder_buffer {
+      public:
+        explicit reorder_buffer (std::size_t max_batches)
+          : max_batches(max_batches)
+          , in_flight(0)
+          , next_sequence(0)
+          , total(0)
+          , finished(false)
+          , aborted(false)
+          , stop_at(no_stop)
+        {}
+
+        /// Wait until a new batch may be read, return false if the writer gave up or a batch failed.
+        bool acquire () {
+          std::unique_lock<std::mutex> lock(mutex);
+          condition.wait(lock, [&] () {
+            return aborted || (stop_at != no_stop) || (in_flight < max_batches);
+          });
+          if (aborted || (stop_at != no_stop)) {
+            return false;
+          }
+          ++in_flight;
+          return true;
+        }
+
+        void put (batch_ptr b) {
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            const std::size_t sequence = b->sequence;
+            done.emplace(sequence, std::move(b));
+          }
+          condition.notify_all();
+        }
+
+        /// Called by the reader after the last batch.
+        void finish (std::size_t count) {
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            total = count;
+            finished = true;
+          }
+          condition.notify_all();
+        }
+
+        /// Called by a transformer if a batch failed. Batches before it are still handed out, no later ones.
+        void fail (std::size_t sequence) {
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop_at = std::min(stop_at, sequence);
+          }
+          condition.notify_all();
+        }
+
+        /// @return true, if a batch before sequence failed, so it will not be written.
+        bool is_dropped (std::size_t sequence) {
+          std::lock_guard<std::mutex> lock(mutex);
+          return sequence > stop_at;
+        }
+
+        /// Called by the writer if it can not write any more.
+        void abort () {
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            aborted = true;
+          }
+          condition.notify_all();
+        }
+
+        /// The next batch in sequence order, or nullptr after the last one.
+        batch_ptr next () {
+          std::unique_lock<std::mutex> lock(mutex);
+          condition.wait(lock, [&] () {
+            return (next_sequence >= stop_at) || (done.find(next_sequence) != done.end()) ||
+                   (finished && (next_sequence == total));
+          });
+          auto i = done.find(next_sequence);
+          if ((next_sequence >= stop_at) || (i == done.end())) {
+            return nullptr;
+          }
+          batch_ptr b = std::move(i->second);
+          done.erase(i);
+          ++next_sequence;
+          --in_flight;
+          lock.unlock();
+          condition.notify_all();
+          return b;
+        }
+
+      private:
+        static constexpr std::size_t no_stop = std::numeric_limits<std::size_t>::max();
+
+        const std::size_t max_batches;
+        std::size_t in_flight;
+        std::size_t next_sequence;
+        std::size_t total;
+        bool finished;
+        bool aborted;
+        std::size_t stop_at;
+        std::map<std::size_t, batch_ptr> done;
+        std::condition_variable condition;
+        std::mutex mutex;
+      };
+
+    } // namespace
+
+    // --------------------------------------------------------------------------
+    void transform_csv_data (std::istream& in, std::ostream& out, char delimiter, bool ignoreFirst,
+                             const row_transform& fn, const transform_options& options) {
+      const std::size_t workers = options.workers ? options.workers
+                                                  : std::max(1U, std::thread::hardware_concurrency());
+      const std::size_t batch_size = std::max<std::size_t>(options.batch_size, 1);
+      const std::size_t max_batches = options.max_batches ? options.max_batches : 2 * workers;
+
+      blocking_queue<batch_ptr> work;
+      reorder_buffer ordered(max_batches);
+
+      std::mutex error_mutex;
+      std::exception_ptr error;
+      // Sequence of the batch that failed, the error of the first batch in order wins.
+      std::size_t error_sequence = std::numeric_limits<std::size_t>::max();
+
+      std::thread reader([&] () {
+        std::size_t sequence = 0;
+        bool header = ignoreFirst;
+        batch_ptr current;
+        while (in.good()) {
+          std::vector<std::string> line = parse_csv_line(in, delimiter);
+          if (!in.good() && (line.size() == 1) && line.front().empty()) {
+            break; // line end at end of file
+          }
+          if (!current) {
+            if (!ordered.acquire()) {
+              break;
+            }
+            current = std::make_shared<batch>(batch{sequence++, header, {}});
+            current->rows.reserve(header ? 1 : batch_size);
+          }
+          current->rows.emplace_back(std::move(line));
+          if (header || (current->rows.size() == batch_size)) {
+            work.enqueue(std::move(current));
+            current.reset();
+            header = false;
+          }
+        }
+        if (current) {
+          work.enqueue(std::move(current));
+        }
+        work.close();
+        ordered.finish(sequence);
+      });
+
+      std::vector<std::thread> transformers;
+      transformers.reserve(workers);
+      for (std::size_t i = 0; i < workers; ++i) {
+        transformers.emplace_back([&] () {
+          while (std::optional<batch_ptr> next = work.pop()) {
+            batch_ptr& b = *next;
+            if (ordered.is_dropped(b->sequence)) {
+              continue;
+            }
+            if (!b->header) {
+              try {
+                for (auto& row : b->rows) {
+                  fn(row);
+                }
+              } catch (...) {
+                {
+                  std::lock_guard<std::mutex> lock(error_mutex);
+                  if (!error || (b->sequence < error_sequence)) {
+                    error = std::current_exception();
+                    error_sequence = b->sequence;
+                  }
+                }
+                ordered.fail(b->sequence);
+                work.close();
+                continue;
+              }
+            }
+            ordered.put(std::move(b));
+          }
+        });
+      }
+
+      try {
+        while (batch_ptr b = ordered.next()) {
+          for (const auto& row : b->rows) {
+            write_csv_line(out, row, delimiter);
+          }
+        }
+      } catch (...) {
+        ordered.abort();
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+
+      reader.join();
+      for (auto& t : transformers) {
+        t.join();
+      }
+
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+
+  } // namespace csv
+
+} // namespace util
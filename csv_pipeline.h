@@ -0,0 +1,64 @@
+/**
+ * @copyright (c) 2018-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: parallel csv transformation
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <functional>
+#include <vector>
+#include <string>
+#include <iosfwd>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/util-export.h>
+
+
+namespace util {
+
+  namespace csv {
+
+    // --------------------------------------------------------------------------
+    struct transform_options {
+      /// Number of transform threads, 0 uses std::thread::hardware_concurrency().
+      std::size_t workers = 0;
+      /// Number of rows handed to a transform thread at once.
+      std::size_t batch_size = 1024;
+      /// Max number of batches read but not yet written, 0 uses 2 * workers.
+      std::size_t max_batches = 0;
+    };
+
+    typedef std::function<void(std::vector<std::string>&)> row_transform;
+
+    // --------------------------------------------------------------------------
+    /**
+     * Reads csv rows from in, calls fn for each row on one of the transform threads
+     * and writes the changed rows to out in the original order.
+     * If ignoreFirst is set, the first row is copied to out without calling fn.
+     * If fn throws, reading stops and no row of the failing batch or a later batch is written.
+     * The exception is rethrown after the rows of the earlier batches are written.
+     */
+    UTIL_EXPORT void transform_csv_data (std::istream& in, std::ostream& out, char delimiter, bool ignoreFirst,
+                                         const row_transform& fn, const transform_options& options = {});
+
+  } // namespace csv
+
+} // namespace util
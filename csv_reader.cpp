@@ -71,31 +71,94 @@ namespace util {
       }
     }
 
-    std::vector<std::string> parse_csv_line (std::istream& in, int splitChar) {
-      std::vector<std::string> list;
+    namespace {
 
-      int ch = in.get();
-      while ((ch == '\n') || (ch == '\r')) {
-        ch = in.get();
-      }
-      list.emplace_back(csv::parse_entry(in, ch, splitChar));
-      while (ch == splitChar) {
-        ch = in.get();
+      template<typename Stats>
+      std::vector<std::string> parse_line (std::istream& in, int splitChar, Stats& stats) {
+        std::vector<std::string> list;
+
+        int ch = in.get();
+        while ((ch == '\n') || (ch == '\r')) {
+          ch = in.get();
+        }
+        stats.field(ch);
         list.emplace_back(csv::parse_entry(in, ch, splitChar));
+        while (ch == splitChar) {
+          ch = in.get();
+          stats.field(ch);
+          list.emplace_back(csv::parse_entry(in, ch, splitChar));
+        }
+        return list;
+      }
+
+      template<typename Stats>
+      void read_lines (std::istream& source, char delimiter, bool ignoreFirst,
+                       const std::function<void(const std::vector<std::string>&)>& fn, Stats& stats) {
+        std::istream& in = stats.stream(source);
+        while (in.good()) {
+          std::vector<std::string> line = parse_line(in, delimiter, stats);
+          if (ignoreFirst) {
+            ignoreFirst = false;
+          } else {
+            stats.row();
+            stats.call([&] () {
+              fn(line);
+            });
+          }
+        }
       }
-      return list;
+
+    } // namespace
+
+    std::vector<std::string> parse_csv_line (std::istream& in, int splitChar) {
+      detail::no_stats stats;
+      return parse_line(in, splitChar, stats);
     }
 
     void read_csv_data (std::istream& in, char delimiter, bool ignoreFirst,
                         const std::function<void(const std::vector<std::string>&)>& fn) {
-      while (in.good()) {
-        std::vector<std::string> line = parse_csv_line(in, delimiter);
-        if (ignoreFirst) {
-          ignoreFirst = false;
-        } else {
-          fn(line);
+      detail::no_stats stats;
+      read_lines(in, delimiter, ignoreFirst, fn, stats);
+    }
+
+    void read_csv_data (std::istream& source, char delimiter, bool ignoreFirst,
+                        const std::function<void(const std::vector<std::string>&)>& fn,
+                        parse_stats& stats) {
+      detail::counting_stats counting(source, stats);
+      read_lines(source, delimiter, ignoreFirst, fn, counting);
+    }
+
+    /*
+     * Writes an entry, quoted if parse_entry would otherwise not read it back unchanged.
+     */
+    void write_csv_entry (std::ostream& out, const std::string& entry, int splitChar) {
+      const bool need_quotes = !entry.empty() && ((entry.front() == '\'') ||
+                                                  (entry.find_first_of("\"\n\r") != std::string::npos) ||
+                                                  (entry.find((char)splitChar) != std::string::npos));
+      if (!need_quotes) {
+        out << entry;
+        return;
+      }
+      out.put('"');
+      for (char c : entry) {
+        if (c == '"') {
+          out.put('"');
+        }
+        out.put(c);
+      }
+      out.put('"');
+    }
+
+    void write_csv_line (std::ostream& out, const std::vector<std::string>& line, int splitChar) {
+      bool first = true;
+      for (const auto& entry : line) {
+        if (!first) {
+          out.put((char)splitChar);
         }
+        write_csv_entry(out, entry, splitChar);
+        first = false;
       }
+      out.put('\n');
     }
 
     namespace detail {
@@ -136,11 +199,47 @@ namespace util {
         }
       }
 
-      template<>
-      skip csv_element<skip> (std::istream& in, int& ch, int splitChar) {
-        skip_entry(in, ch, splitChar);
-        ch = in.get();
-        return {};
+      counting_streambuf::counting_streambuf (std::istream& source)
+        : source(source)
+        , fetched(0)
+      {
+        setg(buffer, buffer, buffer);
+      }
+
+      counting_streambuf::~counting_streambuf () {
+        const std::streamoff unread = egptr() - gptr();
+        if ((unread > 0) && source.rdbuf()) {
+          source.rdbuf()->pubseekoff(-unread, std::ios_base::cur, std::ios_base::in);
+        }
+      }
+
+      std::size_t counting_streambuf::count () const {
+        return fetched - (egptr() - gptr());
+      }
+
+      counting_streambuf::int_type counting_streambuf::underflow () {
+        const std::streamsize n = source.rdbuf() ? source.rdbuf()->sgetn(buffer, sizeof(buffer)) : 0;
+        if (n <= 0) {
+          source.setstate(std::ios_base::eofbit);
+          return traits_type::eof();
+        }
+        fetched += n;
+        setg(buffer, buffer, buffer + n);
+        return traits_type::to_int_type(buffer[0]);
+      }
+
+      counting_stats::counting_stats (std::istream& source, parse_stats& stats)
+        : stats(stats)
+        , counter(source)
+        , in(&counter)
+        , start(clock::now())
+        , callback_time{}
+      {}
+
+      counting_stats::~counting_stats () {
+        stats.bytes += counter.count();
+        stats.callback_time += callback_time;
+        stats.parse_time += (clock::now() - start) - callback_time;
       }
 
     }
@@ -20,9 +20,13 @@
 //
 // Common includes
 //
+#include <chrono>
 #include <functional>
 #include <vector>
 #include <sstream>
+#include <streambuf>
+#include <tuple>
+#include <type_traits>
 
 // --------------------------------------------------------------------------
 //
@@ -36,6 +40,34 @@ namespace util {
 
   namespace csv {
 
+    // --------------------------------------------------------------------------
+    /**
+     * Counters collected by the read functions taking a parse_stats argument.
+     * The overloads without parse_stats do not collect anything.
+     * The parse time includes the time to read from the stream.
+     */
+    struct parse_stats {
+      typedef std::chrono::steady_clock clock;
+
+      std::size_t bytes = 0;
+      std::size_t rows = 0;
+      std::size_t fields = 0;
+      std::size_t quoted_fields = 0;
+      std::size_t conversion_failures = 0;
+      clock::duration parse_time = {};
+      clock::duration callback_time = {};
+
+      inline void clear () {
+        *this = parse_stats();
+      }
+
+      /// Bytes per second of parse time.
+      inline double throughput () const {
+        const double seconds = std::chrono::duration<double>(parse_time).count();
+        return seconds > 0.0 ? bytes / seconds : 0.0;
+      }
+    };
+
     // --------------------------------------------------------------------------
     UTIL_EXPORT std::string parse_text (std::istream& in, int& ch);
     UTIL_EXPORT std::string parse_none_text (std::istream& in, int& ch, int splitChar = ';');
@@ -43,6 +75,14 @@ namespace util {
     UTIL_EXPORT std::vector<std::string> parse_csv_line (std::istream& in, int splitChar = ';');
     UTIL_EXPORT void read_csv_data (std::istream& in, char delimiter, bool ignoreFirst,
                                     const std::function<void(const std::vector<std::string>&)>& fn);
+    /// The source stream is read ahead blockwise, see detail::counting_streambuf.
+    UTIL_EXPORT void read_csv_data (std::istream& source, char delimiter, bool ignoreFirst,
+                                    const std::function<void(const std::vector<std::string>&)>& fn,
+                                    parse_stats& stats);
+
+    // --------------------------------------------------------------------------
+    UTIL_EXPORT void write_csv_entry (std::ostream& out, const std::string& entry, int splitChar = ';');
+    UTIL_EXPORT void write_csv_line (std::ostream& out, const std::vector<std::string>& line, int splitChar = ';');
 
     // --------------------------------------------------------------------------
     struct skip {
@@ -64,40 +104,153 @@ namespace util {
       UTIL_EXPORT void skip_entry (std::istream& in, int& ch, int splitChar);
 
       // --------------------------------------------------------------------------
-      template<typename T>
-      T csv_element (std::istream& in, int& ch, int splitChar) {
-        T t = util::string::convert::to<T>(parse_entry(in, ch, splitChar));
+      /**
+       * Reads blockwise from the buffer of a source stream and counts the consumed bytes.
+       * Sets eof at the source stream, when the end of its buffer is reached.
+       * On destruction the bytes read ahead but not consumed are given back by seeking the source
+       * back. If the source can not seek, like a pipe, they are lost for later reads from it.
+       */
+      class UTIL_EXPORT counting_streambuf : public std::streambuf {
+      public:
+        explicit counting_streambuf (std::istream& source);
+        ~counting_streambuf ();
+
+        /// @return the number of bytes consumed so far.
+        std::size_t count () const;
+
+      protected:
+        int_type underflow () override;
+
+      private:
+        std::istream& source;
+        std::size_t fetched;
+        char buffer[4096];
+      };
+
+      // --------------------------------------------------------------------------
+      inline bool is_quote (int ch) {
+        return (ch == '"') || (ch == '\'');
+      }
+
+      // --------------------------------------------------------------------------
+      /**
+       * Stats policy of the read functions without parse_stats, all hooks are empty
+       * and the parse loops compile as if they were not there.
+       */
+      struct no_stats {
+        inline std::istream& stream (std::istream& in) {
+          return in;
+        }
+
+        inline void field (int) {}
+
+        inline void row () {}
+
+        template<typename T>
+        inline void convert (const std::string& entry, T& t) {
+          t = util::string::convert::to<T>(entry);
+        }
+
+        template<typename F>
+        inline void call (F&& fn) {
+          fn();
+        }
+      };
+
+      // --------------------------------------------------------------------------
+      /**
+       * Stats policy that counts into a parse_stats. The parse loop reads from stream(),
+       * the totals are added to the parse_stats on destruction.
+       */
+      class UTIL_EXPORT counting_stats {
+      public:
+        typedef parse_stats::clock clock;
+
+        counting_stats (std::istream& source, parse_stats& stats);
+        ~counting_stats ();
+
+        inline std::istream& stream (std::istream&) {
+          return in;
+        }
+
+        inline void field (int first) {
+          ++stats.fields;
+          stats.quoted_fields += is_quote(first);
+        }
+
+        inline void row () {
+          ++stats.rows;
+        }
+
+        template<typename T>
+        inline void convert (const std::string& entry, T& t) {
+          if (!util::string::convert::try_to<T>(entry, t) && !entry.empty()) {
+            ++stats.conversion_failures;
+          }
+        }
+
+        template<typename F>
+        inline void call (F&& fn) {
+          const auto start = clock::now();
+          fn();
+          callback_time += clock::now() - start;
+        }
+
+      private:
+        parse_stats& stats;
+        counting_streambuf counter;
+        std::istream in;
+        const clock::time_point start;
+        clock::duration callback_time;
+      };
+
+      // --------------------------------------------------------------------------
+      template<typename T, typename Stats>
+      T csv_element (std::istream& in, int& ch, int splitChar, Stats& stats) {
+        stats.field(ch);
+        T t = {};
+        if constexpr (std::is_same<T, skip>::value) {
+          skip_entry(in, ch, splitChar);
+        } else {
+          stats.convert(parse_entry(in, ch, splitChar), t);
+        }
         ch = in.get();
         return t;
       }
 
-      template<>
-      UTIL_EXPORT skip csv_element<skip> (std::istream& in, int& ch, int splitChar);
+      template<typename T>
+      T csv_element (std::istream& in, int& ch, int splitChar) {
+        no_stats stats;
+        return csv_element<T>(in, ch, splitChar, stats);
+      }
 
 #ifdef CAN_CALL_VARIADIC_IN_ORDER
       template<typename ... Arguments>
-      std::tuple<Arguments...> csv_tuple (std::istream& in, int& ch, int splitChar) {
-        return std::make_tuple(csv_element<Arguments>(in, ch, splitChar)...);
-      }
+      struct csv_tuple {
+        template<typename Stats>
+        static std::tuple<Arguments...> read (std::istream& in, int& ch, int splitChar, Stats& stats) {
+          return std::make_tuple(csv_element<Arguments>(in, ch, splitChar, stats)...);
+        }
+      };
 #else
 	
       template<typename ... Arguments>
-      struct csv_tuple {
-        static std::tuple<Arguments...> read (std::istream& in, int& ch, int splitChar);
-      };
+      struct csv_tuple;
 
       template<typename T>
       struct csv_tuple<T> {
-        static std::tuple<T> read (std::istream& in, int& ch, int splitChar) {
-          return std::make_tuple(csv_element<T>(in, ch, splitChar));
+        template<typename Stats>
+        static std::tuple<T> read (std::istream& in, int& ch, int splitChar, Stats& stats) {
+          return std::make_tuple(csv_element<T>(in, ch, splitChar, stats));
         }
       };
 
       template<typename T, typename ... Arguments>
       struct csv_tuple<T, Arguments...> {
-        static std::tuple<T, Arguments...> read (std::istream& in, int& ch, int splitChar) {
-          auto lhs = csv_tuple<T>::read(in, ch, splitChar);
-          auto rhs = csv_tuple<Arguments...>::read(in, ch, splitChar);
+        template<typename Stats>
+        static std::tuple<T, Arguments...> read (std::istream& in, int& ch, int splitChar, Stats& stats) {
+          auto lhs = csv_tuple<T>::read(in, ch, splitChar, stats);
+          auto rhs = csv_tuple<Arguments...>::read(in, ch, splitChar, stats);
           return std::tuple_cat(std::move(lhs), std::move(rhs));
         }
       };
@@ -111,6 +264,22 @@ namespace util {
       typedef std::tuple<Arguments...> tuple;
 
       static void read_csv (std::istream& in, char delimiter, bool ignoreFirst, std::function<void(const tuple&)> fn) {
+        detail::no_stats stats;
+        read_lines(in, delimiter, ignoreFirst, fn, stats);
+      }
+
+      /// The source stream is read ahead blockwise, see detail::counting_streambuf.
+      static void read_csv (std::istream& source, char delimiter, bool ignoreFirst, std::function<void(const tuple&)> fn,
+                            parse_stats& stats) {
+        detail::counting_stats counting(source, stats);
+        read_lines(source, delimiter, ignoreFirst, fn, counting);
+      }
+
+    private:
+      template<typename Stats>
+      static void read_lines (std::istream& source, char delimiter, bool ignoreFirst,
+                              const std::function<void(const tuple&)>& fn, Stats& stats) {
+        std::istream& in = stats.stream(source);
         bool ignore = ignoreFirst;
         int ch = in.get();
         while (in.good()) {
@@ -124,7 +293,11 @@ namespace util {
               }
               ignore = false;
             } else {
-              fn(detail::csv_tuple<Arguments...>::read(in, ch, delimiter));
+              const tuple t = detail::csv_tuple<Arguments...>::read(in, ch, delimiter, stats);
+              stats.row();
+              stats.call([&] () {
+                fn(t);
+              });
             }
           }
         }
@@ -0,0 +1,252 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: queue of items due at a time point
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <vector>
+#if defined USE_MINGW && __MINGW_GCC_VERSION < 100000
+#include <mingw/mingw.condition_variable.h>
+#include <mingw/mingw.mutex.h>
+#endif
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/time_util.h>
+
+
+namespace util {
+
+  /**
+   * Blocking queue where each item becomes available at its due time.
+   * Items are kept in a min-heap, items with the same due time keep their fifo order.
+   * A waiting consumer sleeps until the earliest item is due and is woken,
+   * when an earlier item is enqueued.
+   */
+  template<typename T>
+  class delay_queue {
+  public:
+    typedef time::time_point time_point;
+    typedef time::time_point::clock clock;
+
+    delay_queue ()
+      : m_sequence(0)
+      , m_closed(false)
+    {}
+
+    /// Enqueue an item due at time point due.
+    /// @return false if the queue is closed and the item was discarded.
+    bool enqueue (time_point due, const T& t) {
+      return emplace(due, t);
+    }
+
+    /// Enqueue an item due at time point due.
+    /// @return false if the queue is closed and the item was discarded.
+    bool enqueue (time_point due, T&& t) {
+      return emplace(due, std::move(t));
+    }
+
+    /// Enqueue an item due after delay.
+    template<typename Rep, typename Period>
+    bool enqueue_after (const std::chrono::duration<Rep, Period>& delay, T t) {
+      return emplace(clock::now() + std::chrono::duration_cast<time::duration>(delay), std::move(t));
+    }
+
+    /// Construct an item due at time point due.
+    /// @return false if the queue is closed and no item was constructed.
+    template<typename ... Args>
+    bool emplace (time_point due, Args&& ... args) {
+      bool earliest = false;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed) {
+          return false;
+        }
+        m_heap.emplace_back(due, m_sequence++, std::forward<Args>(args)...);
+        std::push_heap(m_heap.begin(), m_heap.end(), later);
+        earliest = (m_heap.front().sequence == m_sequence - 1);
+      }
+      if (earliest) {
+        m_condition.notify_one();
+      }
+      return true;
+    }
+
+    /// Waits until the earliest item is due.
+    /// @return the item, or nothing if the queue is closed and drained.
+    std::optional<T> pop () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      for (;;) {
+        if (m_heap.empty()) {
+          if (m_closed) {
+            return std::nullopt;
+          }
+          m_condition.wait(lock);
+        } else {
+          // Copy, wait_until reads the time point while emplace or clear may change the heap.
+          const time_point due = m_heap.front().due;
+          if (due <= clock::now()) {
+            return take_front();
+          }
+          m_condition.wait_until(lock, due);
+        }
+      }
+    }
+
+    /// Waits until the earliest item is due, but at most maxWait.
+    /// @return the item, or nothing on timeout or if the queue is closed and drained.
+    std::optional<T> pop (const std::chrono::milliseconds maxWait) {
+      const time_point deadline = clock::now() + maxWait;
+      std::unique_lock<std::mutex> lock(m_mutex);
+      for (;;) {
+        const time_point now = clock::now();
+        if (m_heap.empty()) {
+          if (m_closed || (now >= deadline)) {
+            return std::nullopt;
+          }
+          m_condition.wait_until(lock, deadline);
+        } else {
+          const time_point due = m_heap.front().due;
+          if (due <= now) {
+            return take_front();
+          } else if (now >= deadline) {
+            return std::nullopt;
+          }
+          m_condition.wait_until(lock, std::min(due, deadline));
+        }
+      }
+    }
+
+    /// @return the earliest item if it is due, else nothing.
+    std::optional<T> try_pop () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (m_heap.empty() || (m_heap.front().due > clock::now())) {
+        return std::nullopt;
+      }
+      return take_front();
+    }
+
+    /// Dequeue the earliest item if it is due and return true, else return false.
+    bool try_dequeue (T& t) {
+      std::optional<T> item = try_pop();
+      if (!item) {
+        return false;
+      }
+      t = std::move(*item);
+      return true;
+    }
+
+    /// @return the due time of the earliest item, or nothing if the queue is empty.
+    std::optional<time_point> next_due () const {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (m_heap.empty()) {
+        return std::nullopt;
+      }
+      return m_heap.front().due;
+    }
+
+    /// @return true, if the queue is empty.
+    bool isEmpty () const {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      return m_heap.empty();
+    }
+
+    /// @return size of the queue, due or not.
+    std::size_t size () const {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      return m_heap.size();
+    }
+
+    /// Removes all items from the queue.
+    void clear () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_heap.clear();
+      m_condition.notify_all();
+    }
+
+    /// Rejects further items and wakes all waiters. Items already queued are still delivered
+    /// at their due time, pop returns nothing once they are drained. Call clear first to drop them.
+    void close () {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+      }
+      m_condition.notify_all();
+    }
+
+    /// @return true, if close was called.
+    bool is_closed () const {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      return m_closed;
+    }
+
+  private:
+    struct entry {
+      template<typename ... Args>
+      entry (time_point d, std::size_t s, Args&& ... args)
+        : due(d)
+        , sequence(s)
+        , item(std::forward<Args>(args)...)
+      {}
+
+      time_point due;
+      std::size_t sequence;
+      T item;
+    };
+
+    /// Heap order, the earliest due and then the first enqueued entry is at the front.
+    static bool later (const entry& lhs, const entry& rhs) {
+      return (lhs.due > rhs.due) || ((lhs.due == rhs.due) && (lhs.sequence > rhs.sequence));
+    }
+
+    /// The queue must not be empty. Hands the next timer over to another waiting consumer.
+    T take_front () {
+      std::pop_heap(m_heap.begin(), m_heap.end(), later);
+      T item = std::move(m_heap.back().item);
+      m_heap.pop_back();
+      if (!m_heap.empty() || m_closed) {
+        m_condition.notify_one();
+      }
+      return item;
+    }
+
+    /// Min-heap of the items by due time.
+    std::vector<entry> m_heap;
+
+    /// Enqueue counter to keep the order of items with the same due time.
+    std::size_t m_sequence;
+
+    /// Set by close, no further items are accepted.
+    bool m_closed;
+
+    /// Condition to signal an earlier item or close to the waiting consumers.
+    std::condition_variable m_condition;
+
+    /// Mutex for thread safe access to the queue.
+    mutable std::mutex m_mutex;
+
+  };
+
+} // namespace util
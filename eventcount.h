@@ -0,0 +1,158 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: event count
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#if defined USE_MINGW && __MINGW_GCC_VERSION < 100000
+#include <mingw/mingw.condition_variable.h>
+#include <mingw/mingw.mutex.h>
+#endif
+
+
+namespace util {
+
+  /**
+   * Lets lock free structures block on a condition without taking a lock
+   * as long as nobody waits. A notifier only touches the mutex, if there are waiters.
+   *
+   * Waiter:   key = prepare_wait(); if (condition) cancel_wait(); else wait(key);
+   * Notifier: make condition true; notify_all();
+   */
+  class eventcount {
+  public:
+    typedef std::uint32_t key_type;
+
+    eventcount ()
+      : m_epoch(0)
+      , m_waiters(0)
+    {}
+
+    eventcount (const eventcount&) = delete;
+    eventcount& operator= (const eventcount&) = delete;
+
+    /// Register as waiter, the condition must be checked again afterwards.
+    key_type prepare_wait () {
+      m_waiters.fetch_add(1, std::memory_order_seq_cst);
+      return m_epoch.load(std::memory_order_seq_cst);
+    }
+
+    /// Unregister, if the condition became true after prepare_wait.
+    void cancel_wait () {
+      m_waiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    /// Block until a notify happened after prepare_wait returned key.
+    void wait (key_type key) {
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [&] () {
+          return m_epoch.load(std::memory_order_relaxed) != key;
+        });
+      }
+      m_waiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    /// Block until a notify happened after prepare_wait returned key or the deadline is reached.
+    template<typename Clock, typename Duration>
+    bool wait_until (key_type key, const std::chrono::time_point<Clock, Duration>& deadline) {
+      bool notified;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        notified = m_condition.wait_until(lock, deadline, [&] () {
+          return m_epoch.load(std::memory_order_relaxed) != key;
+        });
+      }
+      m_waiters.fetch_sub(1, std::memory_order_seq_cst);
+      return notified;
+    }
+
+    /// Wake up all waiters. Cheap, if nobody waits.
+    void notify_all () {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (m_waiters.load(std::memory_order_relaxed) == 0) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_epoch.fetch_add(1, std::memory_order_relaxed);
+      }
+      m_condition.notify_all();
+    }
+
+    /// Wake up one waiter. Cheap, if nobody waits.
+    void notify_one () {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (m_waiters.load(std::memory_order_relaxed) == 0) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_epoch.fetch_add(1, std::memory_order_relaxed);
+      }
+      m_condition.notify_one();
+    }
+
+    /// Block until pred returns true, pred is called again after each notify.
+    template<typename P>
+    void await (P pred) {
+      while (!pred()) {
+        const key_type key = prepare_wait();
+        if (pred()) {
+          cancel_wait();
+          return;
+        }
+        wait(key);
+      }
+    }
+
+    /// Block until pred returns true or the deadline is reached, returns the last result of pred.
+    template<typename P, typename Clock, typename Duration>
+    bool await_until (P pred, const std::chrono::time_point<Clock, Duration>& deadline) {
+      while (!pred()) {
+        const key_type key = prepare_wait();
+        if (pred()) {
+          cancel_wait();
+          return true;
+        }
+        if (!wait_until(key, deadline)) {
+          return pred();
+        }
+      }
+      return true;
+    }
+
+    template<typename P, typename Rep, typename Period>
+    bool await_for (P pred, const std::chrono::duration<Rep, Period>& timeout) {
+      return await_until(pred, std::chrono::steady_clock::now() + timeout);
+    }
+
+  private:
+    std::atomic<key_type> m_epoch;
+    std::atomic<std::uint32_t> m_waiters;
+    std::condition_variable m_condition;
+    std::mutex m_mutex;
+  };
+
+} // namespace util
@@ -25,6 +25,7 @@
 #include <cstring>
 #endif
 #include <array>
+#include <algorithm>
 
 
 // --------------------------------------------------------------------------
@@ -136,6 +137,41 @@ namespace util {
         return result;
     }
 
+    bool match_wildcard (const std::string& name, const std::string& pattern) {
+      std::size_t n = 0, p = 0;
+      std::size_t star = std::string::npos, mark = 0;
+      while (n < name.size()) {
+        if ((p < pattern.size()) && ((pattern[p] == '?') || (pattern[p] == name[n]))) {
+          ++n;
+          ++p;
+        } else if ((p < pattern.size()) && (pattern[p] == '*')) {
+          star = p++;
+          mark = n;
+        } else if (star != std::string::npos) {
+          p = star + 1;
+          n = ++mark;
+        } else {
+          return false;
+        }
+      }
+      while ((p < pattern.size()) && (pattern[p] == '*')) {
+        ++p;
+      }
+      return p == pattern.size();
+    }
+
+    std::vector<sys_fs::path> find_files (const sys_fs::path& dir, const std::string& pattern) {
+      std::vector<sys_fs::path> files;
+      for (const auto& entry : sys_fs::directory_iterator(dir)) {
+        if (sys_fs::is_regular_file(entry.status()) &&
+            match_wildcard(entry.path().filename().string(), pattern)) {
+          files.emplace_back(entry.path());
+        }
+      }
+      std::sort(files.begin(), files.end());
+      return files;
+    }
+
   } // namespace fs
 
 } // util
@@ -20,6 +20,8 @@
 //
 // Library includes
 //
+#include <vector>
+#include <string>
 #include <util/sys_fs.h>
 #include <util/util-export.h>
 
@@ -44,6 +46,12 @@ namespace util {
 
     UTIL_EXPORT command_result command (const sys_fs::path&);
 
+    /// Matches name against a pattern with the wildcards '*' and '?'.
+    UTIL_EXPORT bool match_wildcard (const std::string& name, const std::string& pattern);
+
+    /// @return the sorted regular files in dir, whose file names match the wildcard pattern.
+    UTIL_EXPORT std::vector<sys_fs::path> find_files (const sys_fs::path& dir, const std::string& pattern = "*");
+
   } // namespace fs
 
 } // namespace util
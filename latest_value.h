@@ -0,0 +1,162 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: seqlock cell holding the latest published value
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/eventcount.h>
+#include <util/wait_strategy.h>
+
+
+namespace util {
+
+  /**
+   * Latest state wins: writers overwrite the value, readers always get the newest complete one.
+   * Implemented as a seqlock, an odd sequence marks a write in progress.
+   * Readers never lock and never block a writer, they retry if a write overlapped the copy.
+   * Writers only wait for each other. The value is kept in atomic words,
+   * so the overlapping accesses are no data race.
+   * Each publish increments the version, readers can wait for a version newer than the one they saw.
+   */
+  template<typename T>
+  class latest_value {
+    static_assert(std::is_trivially_copyable<T>::value, "latest_value needs a trivially copyable type");
+
+  public:
+    typedef std::uint64_t version_type;
+
+    explicit latest_value (const T& initial = T())
+      : m_sequence(0)
+    {
+      write(initial);
+    }
+
+    latest_value (const latest_value&) = delete;
+    latest_value& operator= (const latest_value&) = delete;
+
+    /// Publish a new value and wake waiting readers. @return the new version.
+    version_type store (const T& t) {
+      version_type seq = m_sequence.load(std::memory_order_relaxed);
+      for (;;) {
+        if (((seq & 1) == 0) &&
+            m_sequence.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+          break;
+        }
+        cpu_relax();
+        seq = m_sequence.load(std::memory_order_relaxed);
+      }
+      // the odd sequence must be visible before any word of the new value
+      std::atomic_thread_fence(std::memory_order_release);
+      write(t);
+      m_sequence.store(seq + 2, std::memory_order_release);
+      m_changed.notify_all();
+      return (seq + 2) / 2;
+    }
+
+    /// @return the latest value.
+    T load () const {
+      version_type v;
+      return load(v);
+    }
+
+    /// @return the latest value, its version is written to version.
+    T load (version_type& version) const {
+      T t;
+      for (;;) {
+        const version_type seq = m_sequence.load(std::memory_order_acquire);
+        if ((seq & 1) == 0) {
+          read(t);
+          std::atomic_thread_fence(std::memory_order_acquire);
+          if (m_sequence.load(std::memory_order_relaxed) == seq) {
+            version = seq / 2;
+            return t;
+          }
+        }
+        cpu_relax();
+      }
+    }
+
+    /// @return the number of values stored, 0 for the initial value.
+    version_type version () const {
+      return m_sequence.load(std::memory_order_acquire) / 2;
+    }
+
+    /// If a value newer than version was stored, it is written to t, version is updated and true returned.
+    bool try_load_newer (version_type& version, T& t) const {
+      if (this->version() <= version) {
+        return false;
+      }
+      t = load(version);
+      return true;
+    }
+
+    /// Waits until a value newer than version is stored. @return the value, version is updated.
+    T wait_newer (version_type& version) const {
+      m_changed.await([&] () {
+        return this->version() > version;
+      });
+      return load(version);
+    }
+
+    /// Waits at most maxWait for a value newer than version.
+    /// @return the value and version is updated, or nothing on timeout.
+    std::optional<T> wait_newer (version_type& version, const std::chrono::milliseconds maxWait) const {
+      if (!m_changed.await_for([&] () { return this->version() > version; }, maxWait)) {
+        return std::nullopt;
+      }
+      return load(version);
+    }
+
+  private:
+    typedef std::uintptr_t word;
+    static constexpr std::size_t word_count = (sizeof(T) + sizeof(word) - 1) / sizeof(word);
+
+    void write (const T& t) {
+      word buffer[word_count] = {};
+      std::memcpy(buffer, &t, sizeof(T));
+      for (std::size_t i = 0; i < word_count; ++i) {
+        m_words[i].store(buffer[i], std::memory_order_relaxed);
+      }
+    }
+
+    void read (T& t) const {
+      word buffer[word_count];
+      for (std::size_t i = 0; i < word_count; ++i) {
+        buffer[i] = m_words[i].load(std::memory_order_relaxed);
+      }
+      std::memcpy(&t, buffer, sizeof(T));
+    }
+
+    alignas(64) std::atomic<version_type> m_sequence;
+    std::atomic<word> m_words[word_count];
+    mutable eventcount m_changed;
+  };
+
+} // namespace util
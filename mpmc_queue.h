@@ -0,0 +1,257 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: lock free bounded multi producer multi consumer queue
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/eventcount.h>
+#include <util/wait_strategy.h>
+
+
+namespace util {
+
+  /**
+   * Fixed capacity ring buffer after Dmitry Vyukov, each slot carries a sequence number
+   * telling producers and consumers whose turn it is.
+   * Enqueue and dequeue are lock free, they only block on a full or an empty queue.
+   * The wait strategy W decides how long they busy wait before they park on an eventcount.
+   * Each item or freed slot wakes at most one parked thread, and only if one is parked.
+   * T needs no default constructor, except for the timed dequeue that returns T() on timeout.
+   */
+  template<typename T, typename W = park_wait>
+  class mpmc_queue {
+  public:
+    /// Capacity is rounded up to the next power of two.
+    explicit mpmc_queue (std::size_t capacity = 1024)
+      : m_mask(round_up(capacity) - 1)
+      , m_cells(new cell[m_mask + 1])
+      , m_enqueue_pos(0)
+      , m_dequeue_pos(0)
+    {
+      for (std::size_t i = 0; i <= m_mask; ++i) {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+      }
+    }
+
+    mpmc_queue (const mpmc_queue&) = delete;
+    mpmc_queue& operator= (const mpmc_queue&) = delete;
+
+    ~mpmc_queue () {
+      while (consume([] (T&&) {})) {}
+    }
+
+    /// Enqueue an item if there is space and return true, else return false.
+    template<typename ... Args>
+    bool try_emplace (Args&& ... args) {
+      cell* c = nullptr;
+      std::size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+      for (;;) {
+        c = &m_cells[pos & m_mask];
+        const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+        const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+          if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            break;
+          }
+        } else if (diff < 0) {
+          return false;
+        } else {
+          pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+      }
+      new (c->storage) T(std::forward<Args>(args)...);
+      c->sequence.store(pos + 1, std::memory_order_release);
+      m_not_empty.notify_one();
+      return true;
+    }
+
+    bool try_enqueue (const T& t) {
+      return try_emplace(t);
+    }
+
+    bool try_enqueue (T&& t) {
+      return try_emplace(std::move(t));
+    }
+
+    /// Enqueue an item, waits while the queue is full.
+    void enqueue (const T& t) {
+      wait(m_not_full, [&] () {
+        return try_emplace(t);
+      });
+    }
+
+    /// Enqueue an item, waits while the queue is full.
+    void enqueue (T&& t) {
+      wait(m_not_full, [&] () {
+        return try_emplace(std::move(t));
+      });
+    }
+
+    template<typename I>
+    void enqueue (I i, I end) {
+      for (; i != end; ++i) {
+        enqueue(*i);
+      }
+    }
+
+    /// Dequeue an item if available and return true, else return false.
+    bool try_dequeue (T& t) {
+      if (pop(t)) {
+        m_not_full.notify_one();
+        return true;
+      }
+      return false;
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued.
+    T dequeue () {
+      std::optional<T> t;
+      wait(m_not_empty, [&] () {
+        return consume([&] (T&& item) {
+          t.emplace(std::move(item));
+        });
+      });
+      m_not_full.notify_one();
+      return std::move(*t);
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued, return T() on timeout.
+    T dequeue (const std::chrono::milliseconds maxWait) {
+      T t;
+      auto pred = [&] () {
+        return pop(t);
+      };
+      if (spin_until<W>(pred) || m_not_empty.await_for(pred, maxWait)) {
+        m_not_full.notify_one();
+        return t;
+      }
+      return T();
+    }
+
+    /// A watcher takes no item, so it passes the wake up it may have taken on to a consumer.
+    void wait_until_not_empty (const std::chrono::milliseconds maxWait) {
+      if (m_not_empty.await_for([&] () { return !isEmpty(); }, maxWait)) {
+        m_not_empty.notify_one();
+      }
+    }
+
+    void wait_until_not_empty () {
+      wait(m_not_empty, [&] () { return !isEmpty(); });
+      m_not_empty.notify_one();
+    }
+
+    /// @return true, if the queue is empty. Only a snapshot while others are working.
+    bool isEmpty () const {
+      return size() == 0;
+    }
+
+    /// @return size of the queue. Only a snapshot while others are working.
+    std::size_t size () const {
+      const std::size_t tail = m_dequeue_pos.load(std::memory_order_acquire);
+      const std::size_t head = m_enqueue_pos.load(std::memory_order_acquire);
+      return head > tail ? head - tail : 0;
+    }
+
+    std::size_t capacity () const {
+      return m_mask + 1;
+    }
+
+    /// Removes all items from the queue.
+    void clear () {
+      while (consume([] (T&&) {})) {}
+      m_not_full.notify_all();
+    }
+
+  private:
+    template<typename P>
+    static void wait (eventcount& e, P pred) {
+      if (!spin_until<W>(pred)) {
+        e.await(pred);
+      }
+    }
+
+    static std::size_t round_up (std::size_t n) {
+      std::size_t p = 2;
+      while (p < n) {
+        p <<= 1;
+      }
+      return p;
+    }
+
+    bool pop (T& t) {
+      return consume([&] (T&& item) {
+        t = std::move(item);
+      });
+    }
+
+    /// Passes the next item to fn as rvalue and destroys it. @return false if the queue is empty.
+    template<typename F>
+    bool consume (F fn) {
+      cell* c = nullptr;
+      std::size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+      for (;;) {
+        c = &m_cells[pos & m_mask];
+        const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+        const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+        if (diff == 0) {
+          if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            break;
+          }
+        } else if (diff < 0) {
+          return false;
+        } else {
+          pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        }
+      }
+      T* item = reinterpret_cast<T*>(c->storage);
+      fn(std::move(*item));
+      item->~T();
+      c->sequence.store(pos + m_mask + 1, std::memory_order_release);
+      return true;
+    }
+
+    struct cell {
+      std::atomic<std::size_t> sequence;
+      alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static constexpr std::size_t cache_line = 64;
+
+    const std::size_t m_mask;
+    const std::unique_ptr<cell[]> m_cells;
+
+    alignas(cache_line) std::atomic<std::size_t> m_enqueue_pos;
+    alignas(cache_line) std::atomic<std::size_t> m_dequeue_pos;
+
+    alignas(cache_line) eventcount m_not_empty;
+    alignas(cache_line) eventcount m_not_full;
+  };
+
+} // namespace util
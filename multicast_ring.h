@@ -0,0 +1,252 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: preallocated multicast ring with independent consumers
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <vector>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/eventcount.h>
+#include <util/wait_strategy.h>
+
+
+namespace util {
+
+  /**
+   * Ring of preallocated events, every event is delivered to every consumer.
+   * Producers claim a sequence number, fill the slot in place and publish it.
+   * Each consumer reads the events in place and advances its own cursor.
+   * A consumer can be ordered after others, it only sees an event once all of them are done with it.
+   * A slot is reused, when all consumers have passed it, so the slowest consumer throttles the producers.
+   * All consumers must be added before the first event is published.
+   */
+  template<typename T, typename W = park_wait>
+  class multicast_ring {
+  public:
+    typedef std::int64_t sequence_type;
+
+    // --------------------------------------------------------------------------
+    /// Cursor of one consumer, it must be driven by a single thread.
+    class consumer {
+    public:
+      consumer (const consumer&) = delete;
+      consumer& operator= (const consumer&) = delete;
+
+      /**
+       * Calls fn(const T&, sequence_type) for up to max_n available events, does not wait.
+       * @return the number of events processed.
+       */
+      template<typename F>
+      std::size_t try_consume (F fn, std::size_t max_n = std::numeric_limits<std::size_t>::max()) {
+        const sequence_type first = m_cursor.load(std::memory_order_relaxed);
+        const sequence_type last = available(first, max_n);
+        for (sequence_type seq = first; seq < last; ++seq) {
+          fn(static_cast<const T&>(m_ring.at(seq).event), seq);
+        }
+        if (last > first) {
+          m_cursor.store(last, std::memory_order_release);
+          m_ring.m_progress.notify_all();
+        }
+        return static_cast<std::size_t>(last - first);
+      }
+
+      /**
+       * Calls fn(const T&, sequence_type) for up to max_n events, waits until an event is available
+       * or the ring is closed.
+       * @return the number of events processed, 0 if the ring is closed and all events are processed.
+       */
+      template<typename F>
+      std::size_t consume (F fn, std::size_t max_n = std::numeric_limits<std::size_t>::max()) {
+        const sequence_type first = m_cursor.load(std::memory_order_relaxed);
+        auto pred = [&] () {
+          const bool closed = m_ring.is_closed();
+          return (available(first, 1) > first) || (closed && drained(first));
+        };
+        if (!spin_until<W>(pred)) {
+          m_ring.m_progress.await(pred);
+        }
+        return try_consume(fn, max_n);
+      }
+
+      /// @return the sequence of the next event this consumer will process.
+      sequence_type position () const {
+        return m_cursor.load(std::memory_order_acquire);
+      }
+
+    private:
+      friend class multicast_ring;
+
+      consumer (multicast_ring& ring, std::vector<const consumer*> after)
+        : m_ring(ring)
+        , m_after(std::move(after))
+        , m_cursor(0)
+      {}
+
+      /// @return the end of the published events starting at first that all predecessors are done with.
+      sequence_type available (sequence_type first, std::size_t max_n) const {
+        sequence_type limit = first + static_cast<sequence_type>(std::min<std::size_t>(max_n, m_ring.capacity()));
+        for (const consumer* c : m_after) {
+          limit = std::min(limit, c->position());
+        }
+        sequence_type seq = first;
+        while ((seq < limit) && m_ring.is_published(seq)) {
+          ++seq;
+        }
+        return seq;
+      }
+
+      bool drained (sequence_type next) const {
+        return next >= m_ring.m_claimed.load(std::memory_order_acquire);
+      }
+
+      multicast_ring& m_ring;
+      const std::vector<const consumer*> m_after;
+      alignas(64) std::atomic<sequence_type> m_cursor;
+    };
+
+    /// Capacity is rounded up to a power of two.
+    explicit multicast_ring (std::size_t capacity)
+      : m_mask(round_up(capacity) - 1)
+      , m_slots(new slot[m_mask + 1])
+      , m_claimed(0)
+      , m_closed(false)
+    {}
+
+    multicast_ring (const multicast_ring&) = delete;
+    multicast_ring& operator= (const multicast_ring&) = delete;
+
+    /// Adds a consumer that processes each event after all consumers in after did.
+    consumer& add_consumer (std::initializer_list<const consumer*> after = {}) {
+      m_consumers.emplace_back(new consumer(*this, std::vector<const consumer*>(after)));
+      return *m_consumers.back();
+    }
+
+    /**
+     * Claims the next slot, waits while the slowest consumer is a full ring behind,
+     * calls fill(T&, sequence_type) on the slot in place and publishes it.
+     * @return false if the ring is closed and nothing was published.
+     */
+    template<typename F>
+    bool publish_with (F fill) {
+      if (is_closed()) {
+        return false;
+      }
+      const sequence_type seq = m_claimed.fetch_add(1, std::memory_order_acq_rel);
+      auto pred = [&] () {
+        return seq - static_cast<sequence_type>(capacity()) < min_position();
+      };
+      if (!spin_until<W>(pred)) {
+        m_progress.await(pred);
+      }
+      slot& s = at(seq);
+      fill(s.event, seq);
+      s.published.store(seq + 1, std::memory_order_release);
+      m_progress.notify_all();
+      return true;
+    }
+
+    /// Copies t into the next slot. @return false if the ring is closed.
+    bool publish (const T& t) {
+      return publish_with([&] (T& event, sequence_type) {
+        event = t;
+      });
+    }
+
+    /// Publishing is rejected from now on, consumers return 0 once they processed all events.
+    /// Must not overlap a publish in progress.
+    void close () {
+      m_closed.store(true, std::memory_order_release);
+      m_progress.notify_all();
+    }
+
+    bool is_closed () const {
+      return m_closed.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity () const {
+      return m_mask + 1;
+    }
+
+    /// @return the number of sequences claimed by producers.
+    sequence_type claimed () const {
+      return m_claimed.load(std::memory_order_acquire);
+    }
+
+  private:
+    struct alignas(64) slot {
+      slot ()
+        : published(0)
+      {}
+
+      /// Sequence + 1 of the event last published in this slot.
+      std::atomic<sequence_type> published;
+      T event;
+    };
+
+    static std::size_t round_up (std::size_t n) {
+      std::size_t p = 1;
+      while (p < n) {
+        p <<= 1;
+      }
+      return p;
+    }
+
+    slot& at (sequence_type seq) {
+      return m_slots[static_cast<std::size_t>(seq) & m_mask];
+    }
+
+    const slot& at (sequence_type seq) const {
+      return m_slots[static_cast<std::size_t>(seq) & m_mask];
+    }
+
+    bool is_published (sequence_type seq) const {
+      return at(seq).published.load(std::memory_order_acquire) == seq + 1;
+    }
+
+    /// @return the cursor of the slowest consumer.
+    sequence_type min_position () const {
+      sequence_type pos = std::numeric_limits<sequence_type>::max();
+      for (const auto& c : m_consumers) {
+        pos = std::min(pos, c->position());
+      }
+      return pos;
+    }
+
+    const std::size_t m_mask;
+    const std::unique_ptr<slot[]> m_slots;
+    std::deque<std::unique_ptr<consumer>> m_consumers;
+
+    alignas(64) std::atomic<sequence_type> m_claimed;
+    std::atomic<bool> m_closed;
+
+    alignas(64) eventcount m_progress;
+  };
+
+} // namespace util
@@ -0,0 +1,431 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: chain of worker stages connected by bounded queues
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined USE_MINGW && __MINGW_GCC_VERSION < 100000
+#include <mingw/mingw.mutex.h>
+#include <mingw/mingw.thread.h>
+#endif
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/bounded_queue.h>
+
+
+namespace util {
+
+  // --------------------------------------------------------------------------
+  struct stage_options {
+    /// Number of worker threads of the stage.
+    std::size_t workers = 1;
+    /// Max number of items a worker takes from the input queue at once.
+    std::size_t batch_size = 1;
+    /// Capacity of the input queue, producers of a full stage wait.
+    std::size_t capacity = 64;
+  };
+
+  // --------------------------------------------------------------------------
+  /// Counters of one stage, see pipeline::stats().
+  struct stage_stats {
+    typedef std::chrono::steady_clock clock;
+
+    std::string name;
+    std::size_t workers = 0;
+    /// Items processed, including failed ones.
+    std::uint64_t items = 0;
+    /// Items for which the stage function threw.
+    std::uint64_t errors = 0;
+    /// Number of batches taken from the input queue.
+    std::uint64_t batches = 0;
+    /// Items waiting in the input queue at the time of the snapshot.
+    std::size_t queued = 0;
+    /// Time all workers spent in the stage function and passing its result on, and the longest single item.
+    clock::duration busy_time = clock::duration::zero();
+    clock::duration max_latency = clock::duration::zero();
+    /// Time all workers spent waiting for input.
+    clock::duration idle_time = clock::duration::zero();
+    /// Time since the pipeline was started, until the stage finished.
+    clock::duration elapsed = clock::duration::zero();
+
+    clock::duration mean_latency () const {
+      return items ? busy_time / static_cast<clock::rep>(items) : clock::duration::zero();
+    }
+
+    /// @return processed items per second.
+    double throughput () const {
+      const double seconds = std::chrono::duration<double>(elapsed).count();
+      return seconds > 0 ? static_cast<double>(items) / seconds : 0.0;
+    }
+  };
+
+  namespace detail {
+
+    // --------------------------------------------------------------------------
+    class stage_base {
+    public:
+      typedef stage_stats::clock clock;
+
+      stage_base (std::string name, const stage_options& options)
+        : m_options(options)
+        , m_active(0)
+      {
+        m_options.workers = std::max<std::size_t>(m_options.workers, 1);
+        m_options.batch_size = std::max<std::size_t>(m_options.batch_size, 1);
+        m_stats.name = std::move(name);
+        m_stats.workers = m_options.workers;
+      }
+
+      virtual ~stage_base () = default;
+
+      void start (clock::time_point started) {
+        m_started = started;
+        m_active = m_options.workers;
+        for (std::size_t i = 0; i < m_options.workers; ++i) {
+          m_threads.emplace_back([this] () {
+            run();
+            if (--m_active == 0) {
+              finish();
+            }
+          });
+        }
+      }
+
+      void join () {
+        for (auto& t : m_threads) {
+          t.join();
+        }
+        m_threads.clear();
+      }
+
+      stage_stats stats () const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stage_stats s = m_stats;
+        s.queued = queued();
+        if (s.elapsed == clock::duration::zero() && (m_started != clock::time_point())) {
+          s.elapsed = clock::now() - m_started;
+        }
+        return s;
+      }
+
+      std::exception_ptr error () const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_error;
+      }
+
+    protected:
+      /// Worker loop, returns when the input queue is closed and drained.
+      virtual void run () = 0;
+      /// Closes the output queue, called after the last worker returned.
+      virtual void close_output () = 0;
+      virtual std::size_t queued () const = 0;
+
+      /// Add the counters of one batch.
+      void account (std::uint64_t items, std::uint64_t errors, clock::duration busy,
+                    clock::duration max_latency, clock::duration idle, std::exception_ptr error) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.items += items;
+        m_stats.errors += errors;
+        ++m_stats.batches;
+        m_stats.busy_time += busy;
+        m_stats.max_latency = std::max(m_stats.max_latency, max_latency);
+        m_stats.idle_time += idle;
+        if (error && !m_error) {
+          m_error = error;
+        }
+      }
+
+      stage_options m_options;
+
+    private:
+      void finish () {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_stats.elapsed = clock::now() - m_started;
+        }
+        close_output();
+      }
+
+      std::vector<std::thread> m_threads;
+      std::atomic<std::size_t> m_active;
+      clock::time_point m_started;
+      stage_stats m_stats;
+      std::exception_ptr m_error;
+      mutable std::mutex m_mutex;
+    };
+
+    // --------------------------------------------------------------------------
+    /// Stage reading I from its input queue and writing fn(I) to the input queue of the next stage.
+    /// A stage with O = void is the last one.
+    template<typename I, typename O, typename F>
+    class stage : public stage_base {
+    public:
+      stage (std::string name, F fn, const stage_options& options)
+        : stage_base(std::move(name), options)
+        , m_input(std::max<std::size_t>(options.capacity, 1))
+        , m_output(nullptr)
+        , m_fn(std::move(fn))
+      {}
+
+      bounded_queue<I>& input () {
+        return m_input;
+      }
+
+      /// The next stage sets its input queue here.
+      bounded_queue<O>*& output () {
+        return m_output;
+      }
+
+    protected:
+      void run () override {
+        std::vector<I> batch;
+        batch.reserve(m_options.batch_size);
+        for (;;) {
+          const clock::time_point wait_start = clock::now();
+          if (m_input.dequeue_bulk(std::back_inserter(batch), m_options.batch_size) == 0) {
+            return; // closed and drained
+          }
+          const clock::time_point work_start = clock::now();
+          clock::duration max_latency = clock::duration::zero();
+          std::uint64_t errors = 0;
+          std::exception_ptr error;
+          clock::time_point t = work_start;
+          for (I& item : batch) {
+            try {
+              call(std::move(item));
+            } catch (...) {
+              ++errors;
+              if (!error) {
+                error = std::current_exception();
+              }
+            }
+            const clock::time_point now = clock::now();
+            max_latency = std::max(max_latency, now - t);
+            t = now;
+          }
+          account(batch.size(), errors, t - work_start, max_latency, work_start - wait_start, error);
+          batch.clear();
+        }
+      }
+
+      void close_output () override {
+        if constexpr (!std::is_void<O>::value) {
+          if (m_output) {
+            m_output->close();
+          }
+        }
+      }
+
+      std::size_t queued () const override {
+        return m_input.size();
+      }
+
+    private:
+      void call (I&& item) {
+        if constexpr (std::is_void<O>::value) {
+          m_fn(std::move(item));
+        } else {
+          m_output->enqueue(m_fn(std::move(item)));
+        }
+      }
+
+      bounded_queue<I> m_input;
+      bounded_queue<O>* m_output;
+      F m_fn;
+    };
+
+  } // namespace detail
+
+  template<typename In, typename Out>
+  class pipeline_builder;
+
+  // --------------------------------------------------------------------------
+  /**
+   * Chain of stages, each with its own worker threads, connected by bounded queues.
+   * A full queue blocks the stage in front of it, so a slow stage throttles all stages before it.
+   * close() lets each stage drain its input, then closes the input of the next one.
+   * An exception thrown by a stage function drops that item, the first one is rethrown by wait().
+   *
+   * auto p = util::make_pipeline<std::string>()
+   *            .then("parse", parse, {2, 16})
+   *            .sink("write", write);
+   * p.start();
+   * p.push(line); ...
+   * p.close();
+   * p.wait();
+   */
+  template<typename In>
+  class pipeline {
+  public:
+    typedef stage_stats::clock clock;
+
+    pipeline (pipeline&& rhs)
+      : m_stages(std::move(rhs.m_stages))
+      , m_entry(std::exchange(rhs.m_entry, nullptr))
+      , m_running(std::exchange(rhs.m_running, false))
+    {}
+
+    pipeline& operator= (pipeline&&) = delete;
+
+    /// Closes and waits for a running pipeline, errors are dropped.
+    ~pipeline () {
+      if (m_running) {
+        close();
+        join();
+      }
+    }
+
+    /// Starts the workers of all stages.
+    void start () {
+      const clock::time_point now = clock::now();
+      for (auto& s : m_stages) {
+        s->start(now);
+      }
+      m_running = true;
+    }
+
+    /// Feeds an item into the first stage, waits while it is full. @return false if the pipeline is closed.
+    bool push (const In& t) {
+      return m_entry->enqueue(t);
+    }
+
+    /// Feeds an item into the first stage, waits while it is full. @return false if the pipeline is closed.
+    bool push (In&& t) {
+      return m_entry->enqueue(std::move(t));
+    }
+
+    /// No further items are accepted, the stages finish the queued items and stop one after the other.
+    void close () {
+      m_entry->close();
+    }
+
+    /// Waits until all stages stopped, close must have been called.
+    /// Rethrows the first exception of the first stage that had one.
+    void wait () {
+      join();
+      for (auto& s : m_stages) {
+        if (std::exception_ptr error = s->error()) {
+          std::rethrow_exception(error);
+        }
+      }
+    }
+
+    /// @return the counters of all stages, in stage order.
+    std::vector<stage_stats> stats () const {
+      std::vector<stage_stats> result;
+      result.reserve(m_stages.size());
+      for (const auto& s : m_stages) {
+        result.push_back(s->stats());
+      }
+      return result;
+    }
+
+  private:
+    template<typename, typename> friend class pipeline_builder;
+
+    pipeline ()
+      : m_entry(nullptr)
+      , m_running(false)
+    {}
+
+    void join () {
+      for (auto& s : m_stages) {
+        s->join();
+      }
+      m_running = false;
+    }
+
+    std::vector<std::unique_ptr<detail::stage_base>> m_stages;
+    bounded_queue<In>* m_entry;
+    bool m_running;
+  };
+
+  // --------------------------------------------------------------------------
+  /// Adds stages to a pipeline, Out is the item type produced by the last stage.
+  template<typename In, typename Out>
+  class pipeline_builder {
+  public:
+    /// Adds a stage calling fn(Out&&) for each item, its results are passed to the next stage.
+    template<typename F, typename R = std::decay_t<std::invoke_result_t<F&, Out&&>>>
+    pipeline_builder<In, R> then (std::string name, F fn, const stage_options& options = {}) {
+      static_assert(!std::is_void<R>::value, "the last stage must be added with sink()");
+      auto s = std::make_unique<detail::stage<Out, R, F>>(std::move(name), std::move(fn), options);
+      pipeline_builder<In, R> next(std::move(m_pipeline), &s->output());
+      connect(next.m_pipeline, s->input());
+      next.m_pipeline.m_stages.emplace_back(std::move(s));
+      return next;
+    }
+
+    /// Adds the last stage calling fn(Out&&) for each item, it completes the pipeline.
+    template<typename F>
+    pipeline<In> sink (std::string name, F fn, const stage_options& options = {}) {
+      auto s = std::make_unique<detail::stage<Out, void, F>>(std::move(name), std::move(fn), options);
+      connect(m_pipeline, s->input());
+      m_pipeline.m_stages.emplace_back(std::move(s));
+      return std::move(m_pipeline);
+    }
+
+  private:
+    template<typename, typename> friend class pipeline_builder;
+    template<typename T> friend pipeline_builder<T, T> make_pipeline ();
+
+    pipeline_builder ()
+      : m_tail(nullptr)
+    {}
+
+    pipeline_builder (pipeline<In>&& p, bounded_queue<Out>** tail)
+      : m_pipeline(std::move(p))
+      , m_tail(tail)
+    {}
+
+    void connect (pipeline<In>& p, bounded_queue<Out>& input) {
+      if (m_tail) {
+        *m_tail = &input;
+      } else if constexpr (std::is_same<In, Out>::value) {
+        p.m_entry = &input;
+      }
+    }
+
+    pipeline<In> m_pipeline;
+    /// Output of the previous stage, nullptr for the first stage.
+    bounded_queue<Out>** m_tail;
+  };
+
+  /// Starts building a pipeline fed with items of type In.
+  template<typename In>
+  pipeline_builder<In, In> make_pipeline () {
+    return pipeline_builder<In, In>();
+  }
+
+} // namespace util
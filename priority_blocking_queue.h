@@ -0,0 +1,311 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: blocking queue with priority bands
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <vector>
+#if defined USE_MINGW && __MINGW_GCC_VERSION < 100000
+#include <mingw/mingw.condition_variable.h>
+#include <mingw/mingw.mutex.h>
+#endif
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/ring_buffer.h>
+
+
+namespace util {
+
+  /**
+   * Blocking queue with a fixed number of priority bands, band 0 is the most urgent.
+   * Each band is a fifo in a ring buffer, that doubles its capacity when it is full,
+   * a dequeue takes from the most urgent non empty band.
+   * With a max_age greater zero, an item that waited longer than max_age in a less urgent band
+   * is taken first, so bulk work is delayed but not starved.
+   */
+  template<typename T>
+  class priority_blocking_queue {
+  public:
+    typedef std::chrono::steady_clock clock;
+
+    explicit priority_blocking_queue (std::size_t bands = 3,
+                                      std::chrono::milliseconds max_age = std::chrono::milliseconds(0))
+      : m_max_age(max_age)
+      , m_size(0)
+      , m_closed(false)
+    {
+      const std::size_t count = bands > 0 ? bands : 1;
+      m_bands.reserve(count);
+      for (std::size_t i = 0; i < count; ++i) {
+        m_bands.emplace_back(initial_band_capacity);
+      }
+    }
+
+    /// Enqueue an item into band priority, bands beyond the last go to the last one.
+    /// @return false if the queue is closed and the item was discarded.
+    bool enqueue (std::size_t priority, const T& t) {
+      return emplace(priority, t);
+    }
+
+    /// Enqueue an item into band priority, bands beyond the last go to the last one.
+    /// @return false if the queue is closed and the item was discarded.
+    bool enqueue (std::size_t priority, T&& t) {
+      return emplace(priority, std::move(t));
+    }
+
+    /// Construct an item in band priority.
+    /// @return false if the queue is closed and no item was constructed.
+    template<typename ... Args>
+    bool emplace (std::size_t priority, Args&& ... args) {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed) {
+          return false;
+        }
+        band& b = m_bands[priority < m_bands.size() ? priority : m_bands.size() - 1];
+        if (b.full()) {
+          b.reserve(b.capacity() * 2);
+        }
+        b.emplace_back(m_max_age.count() > 0 ? clock::now() : clock::time_point(),
+                       std::forward<Args>(args)...);
+        ++m_size;
+      }
+      m_condition.notify_all();
+      return true;
+    }
+
+    void wait_until_empty (const std::chrono::milliseconds& timeout) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.wait_for(lock, timeout, [this] () {
+        return m_size == 0;
+      });
+    }
+
+    void wait_until_not_empty (const std::chrono::milliseconds maxWait) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      wait_until_not_empty(lock, maxWait);
+    }
+
+    void wait_until_not_empty () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      wait_until_not_empty(lock);
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued, return T() on timeout.
+    T dequeue (const std::chrono::milliseconds maxWait) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      wait_until_not_empty(lock, maxWait);
+      if (m_size == 0) {
+        return T();
+      }
+      return take_front();
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued, return T() if closed and drained.
+    T dequeue () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      wait_until_not_empty(lock);
+      if (m_size == 0) {
+        return T();
+      }
+      return take_front();
+    }
+
+    /// Dequeue an item if available and return true, else return false.
+    bool try_dequeue (T& t) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (m_size == 0) {
+        return false;
+      }
+      t = take_front();
+      return true;
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued or the queue is closed.
+    /// @return the item, or nothing if the queue is closed and drained.
+    std::optional<T> pop () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      wait_until_not_empty(lock);
+      if (m_size == 0) {
+        return std::nullopt;
+      }
+      return take_front();
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued or the queue is closed.
+    /// @return the item, or nothing on timeout or if the queue is closed and drained.
+    std::optional<T> pop (const std::chrono::milliseconds maxWait) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      wait_until_not_empty(lock, maxWait);
+      if (m_size == 0) {
+        return std::nullopt;
+      }
+      return take_front();
+    }
+
+    /// @return the next item, or nothing if the queue is empty.
+    std::optional<T> try_pop () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (m_size == 0) {
+        return std::nullopt;
+      }
+      return take_front();
+    }
+
+    /// @return true, if the queue is empty.
+    bool isEmpty () const {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      return m_size == 0;
+    }
+
+    /// @return size of the queue.
+    std::size_t size () const {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      return m_size;
+    }
+
+    /// @return number of items in band priority.
+    std::size_t size (std::size_t priority) const {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      return priority < m_bands.size() ? m_bands[priority].size() : 0;
+    }
+
+    std::size_t bands () const {
+      return m_bands.size();
+    }
+
+    /// Removes all items from the queue.
+    void clear () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      for (auto& b : m_bands) {
+        b.clear();
+      }
+      m_size = 0;
+      m_condition.notify_all();
+    }
+
+    void stop_waiters () {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.notify_all();
+    }
+
+    /// Rejects further items and wakes all waiters. Items already queued can still be dequeued,
+    /// pop returns nothing once they are drained.
+    void close () {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+      }
+      m_condition.notify_all();
+    }
+
+    /// @return true, if close was called.
+    bool is_closed () const {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      return m_closed;
+    }
+
+  private:
+    struct entry {
+      template<typename ... Args>
+      entry (clock::time_point t, Args&& ... args)
+        : enqueued(t)
+        , item(std::forward<Args>(args)...)
+      {}
+
+      clock::time_point enqueued;
+      T item;
+    };
+
+    typedef ring_buffer<entry> band;
+
+    static constexpr std::size_t initial_band_capacity = 16;
+
+    void wait_until_not_empty (std::unique_lock<std::mutex>& lock, const std::chrono::milliseconds maxWait) {
+      m_condition.wait_for(lock, maxWait, [this] () {
+        return (m_size > 0) || m_closed;
+      });
+    }
+
+    void wait_until_not_empty (std::unique_lock<std::mutex>& lock) {
+      m_condition.wait(lock, [this] () {
+        return (m_size > 0) || m_closed;
+      });
+    }
+
+    /// The most urgent non empty band, or the band with the oldest item that exceeded max_age.
+    band& next_band () {
+      std::size_t i = 0;
+      while (m_bands[i].empty()) {
+        ++i;
+      }
+      if (m_max_age.count() > 0) {
+        const clock::time_point limit = clock::now() - m_max_age;
+        std::size_t aged = i;
+        clock::time_point oldest = limit;
+        for (std::size_t j = i + 1; j < m_bands.size(); ++j) {
+          if (!m_bands[j].empty() && (m_bands[j].front().enqueued < oldest)) {
+            oldest = m_bands[j].front().enqueued;
+            aged = j;
+          }
+        }
+        i = aged;
+      }
+      return m_bands[i];
+    }
+
+    /// The queue must not be empty.
+    T take_front () {
+      band& b = next_band();
+      T item = std::move(b.front().item);
+      b.pop_front();
+      if (--m_size == 0) {
+        m_condition.notify_all();
+      }
+      return item;
+    }
+
+    /// One fifo per priority.
+    std::vector<band> m_bands;
+
+    /// Items older than this are taken before more urgent ones, zero disables aging.
+    const std::chrono::milliseconds m_max_age;
+
+    /// Number of items in all bands.
+    std::size_t m_size;
+
+    /// Set by close, no further items are accepted.
+    bool m_closed;
+
+    /// Condition to signal new item to dequeuer.
+    std::condition_variable m_condition;
+
+    /// Mutex for thread safe access to the queue.
+    mutable std::mutex m_mutex;
+
+  };
+
+} // namespace util
@@ -0,0 +1,139 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: instrumentation policies for queues
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+
+namespace util {
+
+  /// Snapshot of the counters of a queue_metrics.
+  struct queue_stats {
+    typedef std::chrono::steady_clock clock;
+
+    /// Items accepted by the queue.
+    std::uint64_t enqueued = 0;
+    /// Items handed to a consumer.
+    std::uint64_t dequeued = 0;
+    /// Items removed without reaching a consumer, by overflow or clear.
+    std::uint64_t discarded = 0;
+    /// Largest number of items in the queue.
+    std::size_t high_water = 0;
+    /// Number of items at the time of the snapshot.
+    std::size_t depth = 0;
+    /// Sum and maximum of the time the dequeued items spent in the queue.
+    clock::duration total_latency = clock::duration::zero();
+    clock::duration max_latency = clock::duration::zero();
+    /// Time consumers spent waiting for items.
+    clock::duration idle_time = clock::duration::zero();
+    /// Number of lock acquisitions, and how many of them found the mutex taken.
+    std::uint64_t locks = 0;
+    std::uint64_t contended_locks = 0;
+
+    clock::duration mean_latency () const {
+      return dequeued ? total_latency / static_cast<clock::rep>(dequeued) : clock::duration::zero();
+    }
+  };
+
+  /**
+   * Instrumentation policy without any cost, all hooks are empty.
+   */
+  struct no_metrics {
+    static constexpr bool enabled = false;
+
+    void on_enqueue (std::size_t) {}
+    void on_dequeue () {}
+    void on_discard (std::size_t) {}
+    void on_discard_back (std::size_t) {}
+    void on_idle (queue_stats::clock::duration) {}
+    void on_lock (bool) {}
+  };
+
+  /**
+   * Instrumentation policy counting items, latency, idle time and lock contention.
+   * An enqueue time stamp is kept for each queued item in a parallel fifo.
+   * All hooks are called by the queue while it holds its mutex.
+   */
+  struct queue_metrics {
+    typedef queue_stats::clock clock;
+
+    static constexpr bool enabled = true;
+
+    /// An item was added, depth is the size of the queue afterwards.
+    void on_enqueue (std::size_t depth) {
+      ++m_stats.enqueued;
+      m_stats.high_water = std::max(m_stats.high_water, depth);
+      m_stamps.push_back(clock::now());
+    }
+
+    /// The oldest item was passed to a consumer.
+    void on_dequeue () {
+      const clock::duration latency = clock::now() - m_stamps.front();
+      m_stamps.pop_front();
+      ++m_stats.dequeued;
+      m_stats.total_latency += latency;
+      m_stats.max_latency = std::max(m_stats.max_latency, latency);
+    }
+
+    /// The n oldest items were removed without a consumer.
+    void on_discard (std::size_t n) {
+      m_stats.discarded += n;
+      m_stamps.erase(m_stamps.begin(), m_stamps.begin() + static_cast<std::ptrdiff_t>(n));
+    }
+
+    /// The newest item was passed to a consumer, the n other items were removed.
+    void on_discard_back (std::size_t n) {
+      on_discard(n);
+      on_dequeue();
+    }
+
+    void on_idle (clock::duration d) {
+      m_stats.idle_time += d;
+    }
+
+    void on_lock (bool contended) {
+      ++m_stats.locks;
+      if (contended) {
+        ++m_stats.contended_locks;
+      }
+    }
+
+    queue_stats snapshot () const {
+      queue_stats s = m_stats;
+      s.depth = m_stamps.size();
+      return s;
+    }
+
+    /// Restarts all counters, items already queued are kept.
+    void reset () {
+      m_stats = queue_stats();
+      m_stats.high_water = m_stamps.size();
+    }
+
+  private:
+    queue_stats m_stats;
+    std::deque<clock::time_point> m_stamps;
+  };
+
+} // namespace util
@@ -0,0 +1,272 @@
+/**
+ * @copyright (c) 2018-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ Impl: fixed width and ndjson record reader
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <cstring>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include "record_reader.h"
+
+namespace util {
+
+  namespace record {
+
+    line_scanner::line_scanner (std::istream& in, std::size_t block_size)
+      : in(in)
+      , buffer(block_size > 0 ? block_size : 1)
+      , begin(0)
+      , scanned(0)
+      , end(0)
+    {}
+
+    /*
+     * Moves the remaining data to the front, grows the buffer if it is full and reads the next block.
+     */
+    bool line_scanner::fill () {
+      if (begin > 0) {
+        std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+        end -= begin;
+        scanned -= begin;
+        begin = 0;
+      }
+      if (end == buffer.size()) {
+        buffer.resize(buffer.size() * 2);
+      }
+      if (!in.good()) {
+        return false;
+      }
+      in.read(buffer.data() + end, buffer.size() - end);
+      const std::size_t n = static_cast<std::size_t>(in.gcount());
+      end += n;
+      return n > 0;
+    }
+
+    bool line_scanner::next (std::string_view& line) {
+      for (;;) {
+        const char* first = buffer.data() + scanned;
+        const void* found = std::memchr(first, '\n', end - scanned);
+        if (found) {
+          std::size_t last = static_cast<const char*>(found) - buffer.data();
+          line = std::string_view(buffer.data() + begin, last - begin);
+          if (!line.empty() && (line.back() == '\r')) {
+            line.remove_suffix(1);
+          }
+          begin = scanned = last + 1;
+          return true;
+        }
+        scanned = end;
+        if (!fill()) {
+          if (begin == end) {
+            return false;
+          }
+          line = std::string_view(buffer.data() + begin, end - begin);
+          if (line.back() == '\r') {
+            line.remove_suffix(1);
+          }
+          begin = scanned = end;
+          return true;
+        }
+      }
+    }
+
+    namespace {
+
+      void append_utf8 (std::string& out, unsigned long cp) {
+        if (cp < 0x80) {
+          out.push_back(static_cast<char>(cp));
+        } else if (cp < 0x800) {
+          out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+          out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else if (cp < 0x10000) {
+          out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+          out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+          out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else {
+          out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+          out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+          out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+          out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+      }
+
+      unsigned long hex4 (std::string_view s, std::size_t pos) {
+        if (pos + 4 > s.size()) {
+          return 0xFFFD;
+        }
+        unsigned long cp = 0;
+        const auto result = std::from_chars(s.data() + pos, s.data() + pos + 4, cp, 16);
+        return (result.ptr == s.data() + pos + 4) ? cp : 0xFFFD;
+      }
+
+      void skip_ws (std::string_view s, std::size_t& i) {
+        while ((i < s.size()) && ((s[i] == ' ') || (s[i] == '\t') || (s[i] == '\r'))) {
+          ++i;
+        }
+      }
+
+      /*
+       * Scans a string starting after the opening quote, i ends after the closing quote.
+       */
+      bool scan_string (std::string_view s, std::size_t& i, detail::json_value& v) {
+        const std::size_t first = i;
+        while (i < s.size()) {
+          const char c = s[i];
+          if (c == '"') {
+            v.text = s.substr(first, i - first);
+            ++i;
+            return true;
+          }
+          if (c == '\\') {
+            v.escaped = true;
+            ++i;
+          }
+          ++i;
+        }
+        return false;
+      }
+
+      /*
+       * Skips a nested object or array starting at the opening bracket.
+       */
+      bool skip_nested (std::string_view s, std::size_t& i) {
+        int depth = 0;
+        while (i < s.size()) {
+          const char c = s[i++];
+          if ((c == '{') || (c == '[')) {
+            ++depth;
+          } else if ((c == '}') || (c == ']')) {
+            if (--depth == 0) {
+              return true;
+            }
+          } else if (c == '"') {
+            detail::json_value ignored;
+            if (!scan_string(s, i, ignored)) {
+              return false;
+            }
+          }
+        }
+        return false;
+      }
+
+    } // namespace
+
+    void unescape_json (std::string_view s, std::string& out) {
+      for (std::size_t i = 0; i < s.size(); ++i) {
+        const char c = s[i];
+        if ((c != '\\') || (i + 1 == s.size())) {
+          out.push_back(c);
+          continue;
+        }
+        switch (s[++i]) {
+          case 'b': out.push_back('\b'); break;
+          case 'f': out.push_back('\f'); break;
+          case 'n': out.push_back('\n'); break;
+          case 'r': out.push_back('\r'); break;
+          case 't': out.push_back('\t'); break;
+          case 'u': {
+            unsigned long cp = hex4(s, i + 1);
+            i += 4;
+            if ((cp >= 0xD800) && (cp < 0xDC00) && (i + 2 < s.size()) && (s[i + 1] == '\\') && (s[i + 2] == 'u')) {
+              const unsigned long low = hex4(s, i + 3);
+              if ((low >= 0xDC00) && (low < 0xE000)) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                i += 6;
+              }
+            }
+            append_utf8(out, cp);
+            break;
+          }
+          default: out.push_back(s[i]); break;
+        }
+      }
+    }
+
+    namespace detail {
+
+      bool parse_json_object (std::string_view s,
+                              const std::function<void(const json_value& key, const json_value& value)>& fn) {
+        std::size_t i = 0;
+        skip_ws(s, i);
+        if ((i == s.size()) || (s[i] != '{')) {
+          return false;
+        }
+        ++i;
+        skip_ws(s, i);
+        if ((i < s.size()) && (s[i] == '}')) {
+          return true;
+        }
+        while (i < s.size()) {
+          json_value key;
+          if ((s[i] != '"') || !scan_string(s, ++i, key)) {
+            return false;
+          }
+          skip_ws(s, i);
+          if ((i == s.size()) || (s[i] != ':')) {
+            return false;
+          }
+          ++i;
+          skip_ws(s, i);
+          if (i == s.size()) {
+            return false;
+          }
+          json_value value;
+          const char c = s[i];
+          if (c == '"') {
+            if (!scan_string(s, ++i, value)) {
+              return false;
+            }
+            fn(key, value);
+          } else if ((c == '{') || (c == '[')) {
+            if (!skip_nested(s, i)) {
+              return false;
+            }
+          } else {
+            const std::size_t first = i;
+            while ((i < s.size()) && (s[i] != ',') && (s[i] != '}') &&
+                   (s[i] != ' ') && (s[i] != '\t') && (s[i] != '\r')) {
+              ++i;
+            }
+            value.text = s.substr(first, i - first);
+            value.null = (value.text == "null");
+            fn(key, value);
+          }
+          skip_ws(s, i);
+          if (i == s.size()) {
+            return false;
+          }
+          if (s[i] == '}') {
+            return true;
+          }
+          if (s[i] != ',') {
+            return false;
+          }
+          ++i;
+          skip_ws(s, i);
+        }
+        return false;
+      }
+
+    } // namespace detail
+
+  } // namespace record
+
+} // namespace util
@@ -0,0 +1,293 @@
+/**
+ * @copyright (c) 2018-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: fixed width and ndjson record reader
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <array>
+#include <charconv>
+#include <cstdlib>
+#include <functional>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/csv_reader.h>
+#include <util/util-export.h>
+
+
+namespace util {
+
+  namespace record {
+
+    // --------------------------------------------------------------------------
+    /**
+     * Reads a stream blockwise and splits it into lines without the line end.
+     * A line is only valid until the next call of next().
+     */
+    class UTIL_EXPORT line_scanner {
+    public:
+      explicit line_scanner (std::istream& in, std::size_t block_size = 64 * 1024);
+
+      bool next (std::string_view& line);
+
+    private:
+      bool fill ();
+
+      std::istream& in;
+      std::vector<char> buffer;
+      std::size_t begin;
+      std::size_t scanned;
+      std::size_t end;
+    };
+
+    // --------------------------------------------------------------------------
+    /// Appends the json string content s with resolved escape sequences to out.
+    UTIL_EXPORT void unescape_json (std::string_view s, std::string& out);
+
+    // --------------------------------------------------------------------------
+    //
+    // Convert a field to a value without allocation.
+    // An empty field gives the default value, a not convertible field gives
+    // the default value and false.
+    //
+    inline bool parse_field (std::string_view s, std::string_view& t) {
+      t = s;
+      return true;
+    }
+
+    inline bool parse_field (std::string_view s, std::string& t) {
+      t.assign(s.data(), s.size());
+      return true;
+    }
+
+    inline bool parse_field (std::string_view, util::csv::skip&) {
+      return true;
+    }
+
+    inline bool parse_field (std::string_view s, char& t) {
+      t = s.empty() ? char() : s.front();
+      return s.size() < 2;
+    }
+
+    inline bool parse_field (std::string_view s, bool& t) {
+      t = (s == "1") || (s == "true");
+      return s.empty() || t || (s == "0") || (s == "false");
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value, bool>::type
+    parse_field (std::string_view s, T& t) {
+      t = T();
+      if (s.empty()) {
+        return true;
+      }
+      const char* first = ((s.front() == '+') && (s.size() > 1)) ? s.data() + 1 : s.data();
+      const char* last = s.data() + s.size();
+      const auto result = std::from_chars(first, last, t);
+      if ((result.ec != std::errc()) || (result.ptr != last)) {
+        t = T();
+        return false;
+      }
+      return true;
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+    parse_field (std::string_view s, T& t) {
+      t = T();
+      if (s.empty()) {
+        return true;
+      }
+#if defined(__cpp_lib_to_chars)
+      const char* first = ((s.front() == '+') && (s.size() > 1)) ? s.data() + 1 : s.data();
+      const char* last = s.data() + s.size();
+      const auto result = std::from_chars(first, last, t);
+      if ((result.ec != std::errc()) || (result.ptr != last)) {
+        t = T();
+        return false;
+      }
+      return true;
+#else
+      char text[64];
+      if (s.size() >= sizeof(text)) {
+        return false;
+      }
+      s.copy(text, s.size());
+      text[s.size()] = 0;
+      char* last = nullptr;
+      t = static_cast<T>(std::strtod(text, &last));
+      if (last != text + s.size()) {
+        t = T();
+        return false;
+      }
+      return true;
+#endif
+    }
+
+    /// Fallback for all other types, uses util::string::convert::try_to.
+    template<typename T>
+    typename std::enable_if<!std::is_arithmetic<T>::value, bool>::type
+    parse_field (std::string_view s, T& t) {
+      t = T();
+      return s.empty() || util::string::convert::try_to<T>(std::string(s), t);
+    }
+
+    // --------------------------------------------------------------------------
+    /// Position and length of a column in a fixed width record.
+    struct column {
+      std::size_t offset;
+      std::size_t length;
+    };
+
+    namespace detail {
+
+      // --------------------------------------------------------------------------
+      inline std::string_view trimmed (std::string_view s) {
+        const auto first = s.find_first_not_of(' ');
+        if (first == std::string_view::npos) {
+          return {};
+        }
+        return s.substr(first, s.find_last_not_of(' ') - first + 1);
+      }
+
+      // --------------------------------------------------------------------------
+      template<typename T>
+      void fixed_width_element (std::string_view line, const column& c, T& t) {
+        parse_field(c.offset < line.size() ? trimmed(line.substr(c.offset, c.length)) : std::string_view(), t);
+      }
+
+      template<typename Tuple, typename Layout, std::size_t ... I>
+      void fixed_width_tuple (std::string_view line, const Layout& columns, Tuple& t, std::index_sequence<I...>) {
+        (void)std::initializer_list<int>{(fixed_width_element(line, columns[I], std::get<I>(t)), 0)...};
+      }
+
+      // --------------------------------------------------------------------------
+      template<typename Tuple, std::size_t ... I>
+      void assign_slot (Tuple& t, std::size_t slot, std::string_view value, std::index_sequence<I...>) {
+        (void)std::initializer_list<int>{((slot == I ? (void)parse_field(value, std::get<I>(t)) : (void)0), 0)...};
+      }
+
+      // --------------------------------------------------------------------------
+      /// A json token, strings without quotes.
+      struct json_value {
+        std::string_view text;
+        bool escaped = false;
+        bool null = false;
+      };
+
+      /// Parses a flat json object and calls fn(key, value) for each member, return false if malformed.
+      UTIL_EXPORT bool parse_json_object (std::string_view line,
+                                          const std::function<void(const json_value& key, const json_value& value)>& fn);
+
+    } // namespace detail
+
+    // --------------------------------------------------------------------------
+    /**
+     * Reads fixed width records, one per line, into tuples.
+     * Each column is trimmed from spaces, missing columns are empty.
+     */
+    template<typename ... Arguments>
+    struct fixed_width_reader {
+      typedef std::tuple<Arguments...> tuple;
+      typedef std::array<column, sizeof...(Arguments)> layout;
+
+      static void read (std::istream& in, const layout& columns, bool ignoreFirst, std::function<void(const tuple&)> fn) {
+        line_scanner scanner(in);
+        std::string_view line;
+        tuple t;
+        bool ignore = ignoreFirst;
+        while (scanner.next(line)) {
+          if (ignore) {
+            ignore = false;
+          } else if (!line.empty()) {
+            detail::fixed_width_tuple(line, columns, t, std::index_sequence_for<Arguments...>());
+            fn(t);
+          }
+        }
+      }
+    };
+
+    // --------------------------------------------------------------------------
+    /**
+     * Reads newline delimited json objects into tuples.
+     * keys[i] names the member to store in tuple element i, members with other names,
+     * objects and arrays are ignored. Missing members keep the default value.
+     * A std::string_view element refers into the current line or an internal buffer,
+     * it is only valid during the call of fn. Malformed lines are skipped.
+     */
+    template<typename ... Arguments>
+    struct ndjson_reader {
+      typedef std::tuple<Arguments...> tuple;
+      typedef std::array<std::string_view, sizeof...(Arguments)> keys;
+
+      static void read (std::istream& in, const keys& names, std::function<void(const tuple&)> fn) {
+        line_scanner scanner(in);
+        std::array<std::string, sizeof...(Arguments)> unescaped;
+        std::string key;
+        std::string_view line;
+        tuple t;
+        const std::function<void(const detail::json_value&, const detail::json_value&)> member =
+            [&] (const detail::json_value& k, const detail::json_value& v) {
+          std::string_view name = k.text;
+          if (k.escaped) {
+            key.clear();
+            unescape_json(k.text, key);
+            name = key;
+          }
+          for (std::size_t slot = 0; slot < names.size(); ++slot) {
+            if (names[slot] == name) {
+              if (v.null) {
+                return;
+              }
+              std::string_view value = v.text;
+              if (v.escaped) {
+                unescaped[slot].clear();
+                unescape_json(v.text, unescaped[slot]);
+                value = unescaped[slot];
+              }
+              detail::assign_slot(t, slot, value, std::index_sequence_for<Arguments...>());
+              return;
+            }
+          }
+        };
+        while (scanner.next(line)) {
+          if (line.find_first_not_of(" \t\r") == std::string_view::npos) {
+            continue;
+          }
+          t = tuple();
+          const bool ok = detail::parse_json_object(line, member);
+          if (ok) {
+            fn(t);
+          }
+        }
+      }
+    };
+
+  } // namespace record
+
+} // namespace util
@@ -0,0 +1,172 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: fixed capacity ring buffer
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <memory>
+#include <new>
+#include <utility>
+
+
+namespace util {
+
+  /**
+   * Fifo storage with a capacity fixed at construction, unless it is grown by reserve.
+   * All memory is allocated at once, items are constructed in place. Not thread safe.
+   */
+  template<typename T>
+  class ring_buffer {
+  public:
+    explicit ring_buffer (std::size_t capacity)
+      : m_data(new cell[capacity > 0 ? capacity : 1])
+      , m_capacity(capacity > 0 ? capacity : 1)
+      , m_head(0)
+      , m_size(0)
+    {}
+
+    ring_buffer (ring_buffer&& rhs) noexcept
+      : m_data(std::move(rhs.m_data))
+      , m_capacity(rhs.m_capacity)
+      , m_head(rhs.m_head)
+      , m_size(rhs.m_size)
+    {
+      rhs.m_head = 0;
+      rhs.m_size = 0;
+    }
+
+    ring_buffer (const ring_buffer&) = delete;
+    ring_buffer& operator= (const ring_buffer&) = delete;
+
+    ~ring_buffer () {
+      clear();
+    }
+
+    /// Construct an item at the end, the buffer must not be full.
+    template<typename ... Args>
+    void emplace_back (Args&& ... args) {
+      new (m_data[index(m_size)].storage) T(std::forward<Args>(args)...);
+      ++m_size;
+    }
+
+    void push_back (const T& t) {
+      emplace_back(t);
+    }
+
+    void push_back (T&& t) {
+      emplace_back(std::move(t));
+    }
+
+    T& front () {
+      return *item(m_head);
+    }
+
+    const T& front () const {
+      return *item(m_head);
+    }
+
+    T& back () {
+      return *item(index(m_size - 1));
+    }
+
+    const T& back () const {
+      return *item(index(m_size - 1));
+    }
+
+    /// Remove the first item, the buffer must not be empty.
+    void pop_front () {
+      item(m_head)->~T();
+      m_head = (m_head + 1 == m_capacity) ? 0 : m_head + 1;
+      --m_size;
+    }
+
+    /// Grow the capacity to at least n, the items are moved to the new storage in order.
+    /// If moving an item throws, the buffer is unchanged.
+    void reserve (std::size_t n) {
+      if (n <= m_capacity) {
+        return;
+      }
+      std::unique_ptr<cell[]> data(new cell[n]);
+      std::size_t moved = 0;
+      try {
+        for (; moved < m_size; ++moved) {
+          new (data[moved].storage) T(std::move_if_noexcept(*item(index(moved))));
+        }
+      } catch (...) {
+        while (moved > 0) {
+          reinterpret_cast<T*>(data[--moved].storage)->~T();
+        }
+        throw;
+      }
+      const std::size_t size = m_size;
+      clear();
+      m_data = std::move(data);
+      m_capacity = n;
+      m_head = 0;
+      m_size = size;
+    }
+
+    void clear () {
+      while (m_size > 0) {
+        pop_front();
+      }
+      m_head = 0;
+    }
+
+    bool empty () const {
+      return m_size == 0;
+    }
+
+    bool full () const {
+      return m_size == m_capacity;
+    }
+
+    std::size_t size () const {
+      return m_size;
+    }
+
+    std::size_t capacity () const {
+      return m_capacity;
+    }
+
+  private:
+    struct cell {
+      alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    std::size_t index (std::size_t offset) const {
+      const std::size_t i = m_head + offset;
+      return i >= m_capacity ? i - m_capacity : i;
+    }
+
+    T* item (std::size_t i) {
+      return reinterpret_cast<T*>(m_data[i].storage);
+    }
+
+    const T* item (std::size_t i) const {
+      return reinterpret_cast<const T*>(m_data[i].storage);
+    }
+
+    std::unique_ptr<cell[]> m_data;
+    std::size_t m_capacity;
+    std::size_t m_head;
+    std::size_t m_size;
+  };
+
+} // namespace util
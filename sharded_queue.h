@@ -0,0 +1,331 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: multi lane queue for many producers
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#if defined USE_MINGW && __MINGW_GCC_VERSION < 100000
+#include <mingw/mingw.mutex.h>
+#endif
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/eventcount.h>
+#include <util/wait_strategy.h>
+
+
+namespace util {
+
+  /**
+   * Queue split into lanes with a lock each. Every producer thread is bound to one lane,
+   * so producers only contend with the few others sharing their lane.
+   * Consumers sweep the lanes, starting at a rotating lane, and drain batches.
+   * Items of one producer keep their order, there is no order between producers.
+   * Consumers block on an eventcount, after busy waiting following W.
+   */
+  template<typename T, typename W = park_wait>
+  class sharded_queue {
+  public:
+    /// Lanes is rounded up to a power of two, 0 uses std::thread::hardware_concurrency().
+    explicit sharded_queue (std::size_t lanes = 0)
+      : m_mask(round_up(lanes ? lanes : std::thread::hardware_concurrency()) - 1)
+      , m_lanes(new lane[m_mask + 1])
+      , m_cursor(0)
+      , m_closed(false)
+    {}
+
+    sharded_queue (const sharded_queue&) = delete;
+    sharded_queue& operator= (const sharded_queue&) = delete;
+
+    /// Enqueue an item into the lane of the calling thread.
+    /// @return false if the queue is closed and the item was discarded.
+    bool enqueue (const T& t) {
+      return emplace(t);
+    }
+
+    /// Enqueue an item into the lane of the calling thread.
+    /// @return false if the queue is closed and the item was discarded.
+    bool enqueue (T&& t) {
+      return emplace(std::move(t));
+    }
+
+    /// Construct an item in the lane of the calling thread.
+    /// @return false if the queue is closed and no item was constructed.
+    template<typename ... Args>
+    bool emplace (Args&& ... args) {
+      {
+        lane& l = own_lane();
+        std::lock_guard<std::mutex> lock(l.mutex);
+        if (m_closed.load(std::memory_order_relaxed)) {
+          return false;
+        }
+        l.items.emplace_back(std::forward<Args>(args)...);
+      }
+      m_not_empty.notify_one();
+      return true;
+    }
+
+    /// Enqueue all items with one lock of the lane of the calling thread.
+    /// @return false if the queue is closed and the items were discarded.
+    template<typename I>
+    bool enqueue (I i, I end) {
+      {
+        lane& l = own_lane();
+        std::lock_guard<std::mutex> lock(l.mutex);
+        if (m_closed.load(std::memory_order_relaxed)) {
+          return false;
+        }
+        l.items.insert(l.items.end(), i, end);
+      }
+      m_not_empty.notify_all();
+      return true;
+    }
+
+    /// Dequeue up to max_n available items, does not wait.
+    /// @return the number of items written to out.
+    template<typename O>
+    std::size_t try_dequeue_bulk (O out, std::size_t max_n) {
+      return sweep(out, max_n);
+    }
+
+    /// Dequeue up to max_n items, waits until an item is available or the queue is closed.
+    /// @return the number of items written to out, 0 if the queue is closed and drained.
+    template<typename O>
+    std::size_t dequeue_bulk (O out, std::size_t max_n) {
+      std::size_t n = 0;
+      wait([&] () {
+        n = sweep(out, max_n);
+        return n > 0;
+      });
+      return n;
+    }
+
+    /// Dequeue up to max_n items, waits until an item is available, the queue is closed or maxWait is reached.
+    /// @return the number of items written to out.
+    template<typename O>
+    std::size_t dequeue_bulk (O out, std::size_t max_n, const std::chrono::milliseconds maxWait) {
+      std::size_t n = 0;
+      wait_for([&] () {
+        n = sweep(out, max_n);
+        return n > 0;
+      }, maxWait);
+      return n;
+    }
+
+    /// Dequeue an item if available and return true, else return false.
+    bool try_dequeue (T& t) {
+      T* out = &t;
+      return sweep(out, 1) > 0;
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued, return T() if closed and drained.
+    T dequeue () {
+      T t = T();
+      dequeue_bulk(&t, 1);
+      return t;
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued or the queue is closed.
+    /// @return the item, or nothing if the queue is closed and drained.
+    std::optional<T> pop () {
+      std::optional<T> t;
+      dequeue_bulk(optional_inserter(t), 1);
+      return t;
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued or the queue is closed.
+    /// @return the item, or nothing on timeout or if the queue is closed and drained.
+    std::optional<T> pop (const std::chrono::milliseconds maxWait) {
+      std::optional<T> t;
+      dequeue_bulk(optional_inserter(t), 1, maxWait);
+      return t;
+    }
+
+    /// @return the next item, or nothing if the queue is empty.
+    std::optional<T> try_pop () {
+      std::optional<T> t;
+      optional_inserter out(t);
+      sweep(out, 1);
+      return t;
+    }
+
+    /// @return true, if the queue is empty. Only a snapshot while others are working.
+    bool isEmpty () const {
+      return size() == 0;
+    }
+
+    /// @return size of the queue. Only a snapshot while others are working.
+    std::size_t size () const {
+      std::size_t n = 0;
+      for (std::size_t i = 0; i <= m_mask; ++i) {
+        std::lock_guard<std::mutex> lock(m_lanes[i].mutex);
+        n += m_lanes[i].items.size();
+      }
+      return n;
+    }
+
+    std::size_t lanes () const {
+      return m_mask + 1;
+    }
+
+    /// Removes all items from the queue.
+    void clear () {
+      for (std::size_t i = 0; i <= m_mask; ++i) {
+        std::lock_guard<std::mutex> lock(m_lanes[i].mutex);
+        m_lanes[i].items.clear();
+      }
+    }
+
+    /// Rejects further items and wakes all waiters. Items already queued can still be dequeued,
+    /// pop returns nothing once they are drained.
+    void close () {
+      // holding all lane locks orders the flag against all enqueues
+      for (std::size_t i = 0; i <= m_mask; ++i) {
+        m_lanes[i].mutex.lock();
+      }
+      m_closed.store(true, std::memory_order_release);
+      for (std::size_t i = 0; i <= m_mask; ++i) {
+        m_lanes[i].mutex.unlock();
+      }
+      m_not_empty.notify_all();
+    }
+
+    /// @return true, if close was called.
+    bool is_closed () const {
+      return m_closed.load(std::memory_order_acquire);
+    }
+
+  private:
+    struct alignas(64) lane {
+      mutable std::mutex mutex;
+      std::deque<T> items;
+    };
+
+    /// Output iterator that sets an optional.
+    struct optional_inserter {
+      explicit optional_inserter (std::optional<T>& t)
+        : target(&t)
+      {}
+
+      optional_inserter& operator* () {
+        return *this;
+      }
+
+      optional_inserter& operator++ () {
+        return *this;
+      }
+
+      optional_inserter& operator= (T&& t) {
+        target->emplace(std::move(t));
+        return *this;
+      }
+
+      std::optional<T>* target;
+    };
+
+    static std::size_t round_up (std::size_t n) {
+      std::size_t p = 1;
+      while (p < n) {
+        p <<= 1;
+      }
+      return p;
+    }
+
+    /// Threads are bound to lanes round robin in the order of their first enqueue.
+    lane& own_lane () {
+      static std::atomic<std::size_t> next(0);
+      thread_local const std::size_t id = next.fetch_add(1, std::memory_order_relaxed);
+      return m_lanes[id & m_mask];
+    }
+
+    /**
+     * Takes up to max_n items. The first round takes at most an equal share from each lane,
+     * starting at a rotating lane, a second round fills up the rest.
+     */
+    template<typename O>
+    std::size_t sweep (O& out, std::size_t max_n) {
+      const std::size_t count = m_mask + 1;
+      const std::size_t start = m_cursor.fetch_add(1, std::memory_order_relaxed);
+      const std::size_t share = std::max<std::size_t>(1, max_n / count);
+      std::size_t n = 0;
+      for (std::size_t i = 0; (i < count) && (n < max_n); ++i) {
+        n += drain(m_lanes[(start + i) & m_mask], out, std::min(share, max_n - n));
+      }
+      for (std::size_t i = 0; (i < count) && (n < max_n); ++i) {
+        n += drain(m_lanes[(start + i) & m_mask], out, max_n - n);
+      }
+      return n;
+    }
+
+    template<typename O>
+    static std::size_t drain (lane& l, O& out, std::size_t max_n) {
+      std::lock_guard<std::mutex> lock(l.mutex);
+      std::size_t n = 0;
+      for (; (n < max_n) && !l.items.empty(); ++n) {
+        *out = std::move(l.items.front());
+        ++out;
+        l.items.pop_front();
+      }
+      return n;
+    }
+
+    /// Waits until take returns true or the queue is closed. Close is checked before take, so a closed queue is swept once more.
+    template<typename P>
+    void wait (P take) {
+      auto pred = [&] () {
+        const bool closed = is_closed();
+        return take() || closed;
+      };
+      if (!spin_until<W>(pred)) {
+        m_not_empty.await(pred);
+      }
+    }
+
+    template<typename P>
+    void wait_for (P take, const std::chrono::milliseconds maxWait) {
+      auto pred = [&] () {
+        const bool closed = is_closed();
+        return take() || closed;
+      };
+      if (!spin_until<W>(pred)) {
+        m_not_empty.await_for(pred, maxWait);
+      }
+    }
+
+    const std::size_t m_mask;
+    const std::unique_ptr<lane[]> m_lanes;
+
+    alignas(64) std::atomic<std::size_t> m_cursor;
+    std::atomic<bool> m_closed;
+
+    alignas(64) eventcount m_not_empty;
+  };
+
+} // namespace util
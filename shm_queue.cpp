@@ -0,0 +1,391 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ Impl: interprocess queue in a shared memory segment
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#if defined(__linux__)
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include "shm_queue.h"
+
+namespace util {
+
+  namespace {
+
+    typedef std::atomic<std::uint32_t> futex_word;
+    typedef std::atomic<std::uint64_t> position;
+
+    static_assert(futex_word::is_always_lock_free && position::is_always_lock_free,
+                  "atomics in shared memory must be lock free");
+    static_assert(sizeof(futex_word) == sizeof(std::uint32_t), "futex word must be 32 bit");
+
+    const std::uint32_t shm_magic = 0x53484d51; // "SHMQ"
+    const std::uint32_t shm_version = 1;
+
+    /// Length prefix of the filler that skips the rest of the ring up to the wrap around.
+    const std::uint32_t wrap_marker = 0xffffffff;
+    const std::size_t length_size = sizeof(std::uint32_t);
+    const std::size_t min_capacity = 64;
+
+    std::size_t frame_bytes (std::size_t size) {
+      return (length_size + size + 7) & ~std::size_t(7);
+    }
+
+    std::size_t round_up (std::size_t n) {
+      std::size_t p = min_capacity;
+      while (p < n) {
+        p <<= 1;
+      }
+      return p;
+    }
+
+    std::string segment_name (const std::string& name) {
+      return (!name.empty() && (name.front() == '/')) ? name : "/" + name;
+    }
+
+    [[noreturn]] void throw_errno (const char* what) {
+      throw std::system_error(errno, std::system_category(), what);
+    }
+
+    /// Sleeps while word is expected, until woken or the deadline, deadline nullptr waits forever.
+    void futex_wait (futex_word& word, std::uint32_t expected, const std::chrono::steady_clock::time_point* deadline) {
+      timespec timeout = {0, 0};
+      timespec* t = nullptr;
+      if (deadline) {
+        const auto left = *deadline - std::chrono::steady_clock::now();
+        if (left <= std::chrono::steady_clock::duration::zero()) {
+          return;
+        }
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+        timeout.tv_sec = static_cast<time_t>(ns / 1000000000);
+        timeout.tv_nsec = static_cast<long>(ns % 1000000000);
+        t = &timeout;
+      }
+      // shared futex, the word is mapped by several processes
+      syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT, expected, t, nullptr, 0);
+    }
+
+    void futex_wake (futex_word& word) {
+      syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+    /**
+     * One side of the queue waiting for the other. The waiter announces itself before
+     * it checks the condition a last time, the notifier only calls into the kernel
+     * when somebody announced.
+     */
+    struct alignas(64) waiter {
+      futex_word sequence;
+      futex_word waiting;
+
+      template<typename P>
+      bool await (P pred, const std::chrono::steady_clock::time_point* deadline) {
+        while (!pred()) {
+          if (deadline && (std::chrono::steady_clock::now() >= *deadline)) {
+            return pred();
+          }
+          const std::uint32_t seq = sequence.load(std::memory_order_seq_cst);
+          waiting.store(1, std::memory_order_seq_cst);
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+          if (pred()) {
+            waiting.store(0, std::memory_order_relaxed);
+            return true;
+          }
+          futex_wait(sequence, seq, deadline);
+          waiting.store(0, std::memory_order_relaxed);
+        }
+        return true;
+      }
+
+      void notify () {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed)) {
+          sequence.fetch_add(1, std::memory_order_seq_cst);
+          futex_wake(sequence);
+        }
+      }
+    };
+
+  } // namespace
+
+  // --------------------------------------------------------------------------
+  /// Start of the segment, the ring follows directly.
+  struct shm_frame_queue::header {
+    std::atomic<std::uint32_t> magic;
+    std::uint32_t version;
+    std::uint64_t capacity;
+    futex_word closed;
+
+    /// Byte positions, they only grow. Written by the consumer resp. the producer only.
+    alignas(64) position head;
+    alignas(64) position tail;
+
+    /// The consumer waits for frames, the producer for space.
+    waiter not_empty;
+    waiter not_full;
+  };
+
+  // --------------------------------------------------------------------------
+  shm_frame_queue::shm_frame_queue (const std::string& name, std::size_t capacity)
+    : m_name(segment_name(name))
+    , m_owner(true)
+    , m_mapped(0)
+    , m_header(nullptr)
+    , m_ring(nullptr)
+  {
+    const std::size_t ring = round_up(capacity);
+    ::shm_unlink(m_name.c_str());
+    const int fd = ::shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+      throw_errno("shm_open");
+    }
+    const std::size_t bytes = sizeof(header) + ring;
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+      const int error = errno;
+      ::close(fd);
+      ::shm_unlink(m_name.c_str());
+      errno = error;
+      throw_errno("ftruncate");
+    }
+    map(fd, bytes);
+
+    header* h = new (m_header) header();
+    h->version = shm_version;
+    h->capacity = ring;
+    h->magic.store(shm_magic, std::memory_order_release);
+  }
+
+  shm_frame_queue::shm_frame_queue (const std::string& name)
+    : m_name(segment_name(name))
+    , m_owner(false)
+    , m_mapped(0)
+    , m_header(nullptr)
+    , m_ring(nullptr)
+  {
+    const int fd = ::shm_open(m_name.c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+      throw_errno("shm_open");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      const int error = errno;
+      ::close(fd);
+      errno = error;
+      throw_errno("fstat");
+    }
+    if (static_cast<std::size_t>(st.st_size) < sizeof(header) + min_capacity) {
+      ::close(fd);
+      throw std::runtime_error("shm_frame_queue segment " + m_name + " is not initialized");
+    }
+    map(fd, static_cast<std::size_t>(st.st_size));
+
+    if ((m_header->magic.load(std::memory_order_acquire) != shm_magic) ||
+        (m_header->version != shm_version) ||
+        (sizeof(header) + m_header->capacity != m_mapped)) {
+      ::munmap(m_header, m_mapped);
+      throw std::runtime_error("shm_frame_queue segment " + m_name + " is not initialized");
+    }
+  }
+
+  shm_frame_queue::~shm_frame_queue () {
+    ::munmap(m_header, m_mapped);
+    if (m_owner) {
+      ::shm_unlink(m_name.c_str());
+    }
+  }
+
+  void shm_frame_queue::remove (const std::string& name) {
+    ::shm_unlink(segment_name(name).c_str());
+  }
+
+  void shm_frame_queue::map (int fd, std::size_t bytes) {
+    void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int error = errno;
+    ::close(fd);
+    if (p == MAP_FAILED) {
+      if (m_owner) {
+        ::shm_unlink(m_name.c_str());
+      }
+      errno = error;
+      throw_errno("mmap");
+    }
+    m_mapped = bytes;
+    m_header = static_cast<header*>(p);
+    m_ring = static_cast<char*>(p) + sizeof(header);
+  }
+
+  // --------------------------------------------------------------------------
+  bool shm_frame_queue::try_enqueue (const void* data, std::size_t size) {
+    if (size > max_frame_size()) {
+      throw std::invalid_argument("frame exceeds shm_frame_queue::max_frame_size()");
+    }
+    if (is_closed()) {
+      return false;
+    }
+    const std::uint64_t cap = m_header->capacity;
+    std::uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+    const std::uint64_t head = m_header->head.load(std::memory_order_acquire);
+    const std::size_t bytes = frame_bytes(size);
+    const std::size_t room = static_cast<std::size_t>(cap - (tail & (cap - 1)));
+    const std::size_t filler = (room < bytes) ? room : 0;
+    if (cap - (tail - head) < filler + bytes) {
+      return false;
+    }
+    if (filler) {
+      const std::uint32_t marker = wrap_marker;
+      std::memcpy(m_ring + (tail & (cap - 1)), &marker, length_size);
+      tail += filler;
+    }
+    char* frame = m_ring + (tail & (cap - 1));
+    const std::uint32_t length = static_cast<std::uint32_t>(size);
+    std::memcpy(frame, &length, length_size);
+    std::memcpy(frame + length_size, data, size);
+    m_header->tail.store(tail + bytes, std::memory_order_release);
+    m_header->not_empty.notify();
+    return true;
+  }
+
+  bool shm_frame_queue::enqueue_until (const void* data, std::size_t size, const clock::time_point* deadline) {
+    bool stored = false;
+    m_header->not_full.await([&] () {
+      stored = try_enqueue(data, size);
+      return stored || is_closed();
+    }, deadline);
+    return stored;
+  }
+
+  bool shm_frame_queue::enqueue (const void* data, std::size_t size) {
+    return enqueue_until(data, size, nullptr);
+  }
+
+  bool shm_frame_queue::enqueue (const void* data, std::size_t size, const std::chrono::milliseconds maxWait) {
+    const clock::time_point deadline = clock::now() + maxWait;
+    return enqueue_until(data, size, &deadline);
+  }
+
+  // --------------------------------------------------------------------------
+  const char* shm_frame_queue::front (std::size_t& size) {
+    const std::uint64_t cap = m_header->capacity;
+    std::uint64_t head = m_header->head.load(std::memory_order_relaxed);
+    const std::uint64_t tail = m_header->tail.load(std::memory_order_acquire);
+    if (head == tail) {
+      return nullptr;
+    }
+    std::uint32_t length;
+    std::memcpy(&length, m_ring + (head & (cap - 1)), length_size);
+    if (length == wrap_marker) {
+      head += cap - (head & (cap - 1));
+      m_header->head.store(head, std::memory_order_release);
+      std::memcpy(&length, m_ring + (head & (cap - 1)), length_size);
+    }
+    size = length;
+    return m_ring + (head & (cap - 1)) + length_size;
+  }
+
+  void shm_frame_queue::pop_front () {
+    const std::uint64_t cap = m_header->capacity;
+    const std::uint64_t head = m_header->head.load(std::memory_order_relaxed);
+    std::uint32_t length;
+    std::memcpy(&length, m_ring + (head & (cap - 1)), length_size);
+    m_header->head.store(head + frame_bytes(length), std::memory_order_release);
+    m_header->not_full.notify();
+  }
+
+  bool shm_frame_queue::wait_not_empty (const clock::time_point* deadline) {
+    auto ready = [&] () {
+      const bool closed = is_closed();
+      return !isEmpty() || closed;
+    };
+    m_header->not_empty.await(ready, deadline);
+    return !isEmpty();
+  }
+
+  std::optional<std::vector<char>> shm_frame_queue::pop () {
+    std::optional<std::vector<char>> frame;
+    consume([&] (const char* data, std::size_t size) {
+      frame.emplace(data, data + size);
+    });
+    return frame;
+  }
+
+  std::optional<std::vector<char>> shm_frame_queue::pop (const std::chrono::milliseconds maxWait) {
+    std::optional<std::vector<char>> frame;
+    consume([&] (const char* data, std::size_t size) {
+      frame.emplace(data, data + size);
+    }, maxWait);
+    return frame;
+  }
+
+  std::optional<std::vector<char>> shm_frame_queue::try_pop () {
+    std::optional<std::vector<char>> frame;
+    try_consume([&] (const char* data, std::size_t size) {
+      frame.emplace(data, data + size);
+    });
+    return frame;
+  }
+
+  // --------------------------------------------------------------------------
+  void shm_frame_queue::close () {
+    m_header->closed.store(1, std::memory_order_release);
+    m_header->not_empty.notify();
+    m_header->not_full.notify();
+  }
+
+  bool shm_frame_queue::is_closed () const {
+    return m_header->closed.load(std::memory_order_acquire) != 0;
+  }
+
+  bool shm_frame_queue::isEmpty () const {
+    return size() == 0;
+  }
+
+  std::size_t shm_frame_queue::size () const {
+    const std::uint64_t head = m_header->head.load(std::memory_order_acquire);
+    const std::uint64_t tail = m_header->tail.load(std::memory_order_acquire);
+    return static_cast<std::size_t>(tail - head);
+  }
+
+  std::size_t shm_frame_queue::capacity () const {
+    return static_cast<std::size_t>(m_header->capacity);
+  }
+
+  std::size_t shm_frame_queue::max_frame_size () const {
+    return capacity() / 2 - length_size;
+  }
+
+} // namespace util
+
+#endif // __linux__
@@ -0,0 +1,279 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: interprocess queue in a shared memory segment
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+#if defined(__linux__)
+#define UTIL_HAS_SHM_QUEUE 1
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/util-export.h>
+
+
+namespace util {
+
+  /**
+   * Ring of variable length byte frames in a shm_open/mmap segment, shared by two processes.
+   * Exactly one producer and one consumer, in the same or in different processes.
+   * Frames are copied once into the segment and read in place by the consumer.
+   * Enqueue and dequeue take no lock and make no system call, only a side that has to wait
+   * sleeps on a futex in the segment, and only then the other side issues a wake up.
+   *
+   * One process creates the segment with a capacity, the other opens it by name.
+   * The creator removes the name again on destruction.
+   */
+  class UTIL_EXPORT shm_frame_queue {
+  public:
+    typedef std::chrono::steady_clock clock;
+
+    /// Creates the segment, an old segment of the same name is replaced.
+    /// Capacity in bytes is rounded up to a power of two. Throws std::system_error.
+    shm_frame_queue (const std::string& name, std::size_t capacity);
+
+    /// Opens a segment created by another process. Throws std::system_error,
+    /// or std::runtime_error if the segment is not initialized yet.
+    explicit shm_frame_queue (const std::string& name);
+
+    ~shm_frame_queue ();
+
+    shm_frame_queue (const shm_frame_queue&) = delete;
+    shm_frame_queue& operator= (const shm_frame_queue&) = delete;
+
+    /// Removes the name of a segment, processes that mapped it keep it until they unmap.
+    static void remove (const std::string& name);
+
+    // ---------------------------------------------------------------------
+    // producer side
+
+    /// Enqueue a frame, waits while there is no space. @return false if the queue is closed.
+    /// Throws std::invalid_argument if size exceeds max_frame_size().
+    bool enqueue (const void* data, std::size_t size);
+
+    /// Enqueue a frame, waits at most maxWait for space. @return false on timeout or if the queue is closed.
+    bool enqueue (const void* data, std::size_t size, const std::chrono::milliseconds maxWait);
+
+    /// Enqueue a frame if there is space. @return false if the queue is full or closed.
+    bool try_enqueue (const void* data, std::size_t size);
+
+    // ---------------------------------------------------------------------
+    // consumer side
+
+    /// Calls fn(const char*, std::size_t) with the next frame in place, waits until one is available.
+    /// @return false if the queue is closed and drained.
+    template<typename F>
+    bool consume (F fn) {
+      return wait_not_empty(nullptr) && try_consume(fn);
+    }
+
+    /// Calls fn(const char*, std::size_t) with the next frame in place, waits at most maxWait.
+    /// @return false on timeout or if the queue is closed and drained.
+    template<typename F>
+    bool consume (F fn, const std::chrono::milliseconds maxWait) {
+      const clock::time_point deadline = clock::now() + maxWait;
+      return wait_not_empty(&deadline) && try_consume(fn);
+    }
+
+    /// Calls fn(const char*, std::size_t) with the next frame in place. @return false if the queue is empty.
+    template<typename F>
+    bool try_consume (F fn) {
+      std::size_t size = 0;
+      const char* data = front(size);
+      if (!data) {
+        return false;
+      }
+      fn(data, size);
+      pop_front();
+      return true;
+    }
+
+    /// @return a copy of the next frame, waits until one is available, nothing if the queue is closed and drained.
+    std::optional<std::vector<char>> pop ();
+
+    /// @return a copy of the next frame, nothing on timeout or if the queue is closed and drained.
+    std::optional<std::vector<char>> pop (const std::chrono::milliseconds maxWait);
+
+    /// @return a copy of the next frame, or nothing if the queue is empty.
+    std::optional<std::vector<char>> try_pop ();
+
+    // ---------------------------------------------------------------------
+    /// Rejects further frames and wakes both sides. Queued frames can still be consumed.
+    void close ();
+
+    /// @return true, if close was called by either process.
+    bool is_closed () const;
+
+    /// @return true, if the queue is empty. Only a snapshot while others are working.
+    bool isEmpty () const;
+
+    /// @return the number of bytes used by queued frames. Only a snapshot while others are working.
+    std::size_t size () const;
+
+    /// @return the size of the ring in bytes.
+    std::size_t capacity () const;
+
+    /// @return the largest frame that fits into the ring.
+    std::size_t max_frame_size () const;
+
+  private:
+    struct header;
+
+    void map (int fd, std::size_t bytes);
+
+    /// @return the next frame in place and its size, or nullptr if the queue is empty.
+    const char* front (std::size_t& size);
+    /// Removes the frame returned by front.
+    void pop_front ();
+
+    /// Waits until a frame is available or the queue is closed, deadline nullptr waits forever.
+    /// @return false if there is no frame.
+    bool wait_not_empty (const clock::time_point* deadline);
+    bool enqueue_until (const void* data, std::size_t size, const clock::time_point* deadline);
+
+    std::string m_name;
+    bool m_owner;
+    std::size_t m_mapped;
+    header* m_header;
+    char* m_ring;
+  };
+
+  /**
+   * Interprocess queue of trivially copyable records, based on shm_frame_queue.
+   * Same restrictions: one producer and one consumer.
+   */
+  template<typename T>
+  class shm_queue {
+    static_assert(std::is_trivially_copyable<T>::value, "shm_queue needs a trivially copyable type");
+
+  public:
+    /// Creates the segment with space for at least capacity records.
+    shm_queue (const std::string& name, std::size_t capacity)
+      : m_frames(name, std::max<std::size_t>(capacity, 2) * frame_size)
+    {}
+
+    /// Opens a segment created by another process.
+    explicit shm_queue (const std::string& name)
+      : m_frames(name)
+    {}
+
+    /// Enqueue an item, waits while the queue is full. @return false if the queue is closed.
+    bool enqueue (const T& t) {
+      return m_frames.enqueue(&t, sizeof(T));
+    }
+
+    /// Enqueue an item, waits at most maxWait for space. @return false on timeout or if the queue is closed.
+    bool enqueue (const T& t, const std::chrono::milliseconds maxWait) {
+      return m_frames.enqueue(&t, sizeof(T), maxWait);
+    }
+
+    /// Enqueue an item if there is space. @return false if the queue is full or closed.
+    bool try_enqueue (const T& t) {
+      return m_frames.try_enqueue(&t, sizeof(T));
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued, return T() if closed and drained.
+    T dequeue () {
+      return pop().value_or(T());
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued, return T() on timeout.
+    T dequeue (const std::chrono::milliseconds maxWait) {
+      return pop(maxWait).value_or(T());
+    }
+
+    /// Dequeue an item if available and return true, else return false.
+    bool try_dequeue (T& t) {
+      return m_frames.try_consume(reader(t));
+    }
+
+    /// @return the next item, waits until one is available, nothing if the queue is closed and drained.
+    std::optional<T> pop () {
+      T t;
+      if (m_frames.consume(reader(t))) {
+        return t;
+      }
+      return std::nullopt;
+    }
+
+    /// @return the next item, nothing on timeout or if the queue is closed and drained.
+    std::optional<T> pop (const std::chrono::milliseconds maxWait) {
+      T t;
+      if (m_frames.consume(reader(t), maxWait)) {
+        return t;
+      }
+      return std::nullopt;
+    }
+
+    /// @return the next item, or nothing if the queue is empty.
+    std::optional<T> try_pop () {
+      T t;
+      if (try_dequeue(t)) {
+        return t;
+      }
+      return std::nullopt;
+    }
+
+    void close () {
+      m_frames.close();
+    }
+
+    bool is_closed () const {
+      return m_frames.is_closed();
+    }
+
+    bool isEmpty () const {
+      return m_frames.isEmpty();
+    }
+
+    /// @return the number of queued items. Only a snapshot while others are working.
+    std::size_t size () const {
+      return m_frames.size() / frame_size;
+    }
+
+    std::size_t capacity () const {
+      return m_frames.capacity() / frame_size;
+    }
+
+  private:
+    /// Bytes of a record in the ring: length prefix, record, padding to 8 bytes.
+    static constexpr std::size_t frame_size = (4 + sizeof(T) + 7) & ~std::size_t(7);
+
+    static auto reader (T& t) {
+      return [&t] (const char* data, std::size_t) {
+        std::memcpy(&t, data, sizeof(T));
+      };
+    }
+
+    shm_frame_queue m_frames;
+  };
+
+} // namespace util
+
+#endif // __linux__
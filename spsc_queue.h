@@ -0,0 +1,249 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: wait free single producer single consumer queue
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/eventcount.h>
+#include <util/wait_strategy.h>
+
+
+namespace util {
+
+  /**
+   * Fixed capacity ring buffer for exactly one producer and one consumer thread.
+   * try_enqueue and try_dequeue are wait free. Each side keeps a cached copy of
+   * the index of the other side and only reloads it, when the queue looks full or empty.
+   * With Blocking the waiting calls sleep on an eventcount, otherwise they spin and yield,
+   * which saves a memory fence per operation.
+   */
+  template<typename T, bool Blocking = true>
+  class spsc_queue {
+  public:
+    /// Capacity is rounded up to the next power of two.
+    explicit spsc_queue (std::size_t capacity = 1024)
+      : m_head(0)
+      , m_cached_tail(0)
+      , m_tail(0)
+      , m_cached_head(0)
+      , m_mask(round_up(capacity) - 1)
+      , m_cells(new cell[m_mask + 1])
+    {}
+
+    spsc_queue (const spsc_queue&) = delete;
+    spsc_queue& operator= (const spsc_queue&) = delete;
+
+    ~spsc_queue () {
+      const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+      for (std::size_t i = m_head.load(std::memory_order_relaxed); i != tail; ++i) {
+        item(i)->~T();
+      }
+    }
+
+    // ---------------------------------------------------------------------
+    // producer side
+
+    /// Enqueue an item if there is space and return true, else return false.
+    template<typename ... Args>
+    bool try_emplace (Args&& ... args) {
+      const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+      if (tail - m_cached_head > m_mask) {
+        m_cached_head = m_head.load(std::memory_order_acquire);
+        if (tail - m_cached_head > m_mask) {
+          return false;
+        }
+      }
+      new (m_cells[tail & m_mask].storage) T(std::forward<Args>(args)...);
+      m_tail.store(tail + 1, std::memory_order_release);
+      if (Blocking) {
+        m_not_empty.notify_all();
+      }
+      return true;
+    }
+
+    bool try_enqueue (const T& t) {
+      return try_emplace(t);
+    }
+
+    bool try_enqueue (T&& t) {
+      return try_emplace(std::move(t));
+    }
+
+    /// Enqueue an item, waits while the queue is full.
+    void enqueue (const T& t) {
+      wait(m_not_full, [&] () {
+        return try_emplace(t);
+      });
+    }
+
+    /// Enqueue an item, waits while the queue is full.
+    void enqueue (T&& t) {
+      wait(m_not_full, [&] () {
+        return try_emplace(std::move(t));
+      });
+    }
+
+    // ---------------------------------------------------------------------
+    // consumer side
+
+    /// @return the next item to read in place, or nullptr if the queue is empty.
+    T* front () {
+      const std::size_t head = m_head.load(std::memory_order_relaxed);
+      if (head == m_cached_tail) {
+        m_cached_tail = m_tail.load(std::memory_order_acquire);
+        if (head == m_cached_tail) {
+          return nullptr;
+        }
+      }
+      return item(head);
+    }
+
+    /// Removes the item returned by front.
+    void pop () {
+      const std::size_t head = m_head.load(std::memory_order_relaxed);
+      item(head)->~T();
+      m_head.store(head + 1, std::memory_order_release);
+      if (Blocking) {
+        m_not_full.notify_all();
+      }
+    }
+
+    /// Dequeue an item if available and return true, else return false.
+    bool try_dequeue (T& t) {
+      T* i = front();
+      if (!i) {
+        return false;
+      }
+      t = std::move(*i);
+      pop();
+      return true;
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued.
+    T dequeue () {
+      T t;
+      wait(m_not_empty, [&] () {
+        return try_dequeue(t);
+      });
+      return t;
+    }
+
+    /// Dequeue an item if available, else waits until a new item is enqueued, return T() on timeout.
+    T dequeue (const std::chrono::milliseconds maxWait) {
+      T t;
+      if (wait_for(m_not_empty, [&] () { return try_dequeue(t); }, maxWait)) {
+        return t;
+      }
+      return T();
+    }
+
+    // ---------------------------------------------------------------------
+    /// @return true, if the queue is empty. Only a snapshot while others are working.
+    bool isEmpty () const {
+      return size() == 0;
+    }
+
+    /// @return size of the queue. Only a snapshot while others are working.
+    std::size_t size () const {
+      const std::size_t head = m_head.load(std::memory_order_acquire);
+      const std::size_t tail = m_tail.load(std::memory_order_acquire);
+      return tail - head;
+    }
+
+    std::size_t capacity () const {
+      return m_mask + 1;
+    }
+
+  private:
+    static std::size_t round_up (std::size_t n) {
+      std::size_t p = 2;
+      while (p < n) {
+        p <<= 1;
+      }
+      return p;
+    }
+
+    T* item (std::size_t i) {
+      return reinterpret_cast<T*>(m_cells[i & m_mask].storage);
+    }
+
+    /// Retries before sleeping, a waiting partner usually catches up within a few tries.
+    typedef spin_then_park<64, 128> blocking_wait;
+
+    template<typename P>
+    static void wait (eventcount& e, P pred) {
+      if (Blocking) {
+        if (!spin_until<blocking_wait>(pred)) {
+          e.await(pred);
+        }
+      } else {
+        while (!pred()) {
+          std::this_thread::yield();
+        }
+      }
+    }
+
+    template<typename P>
+    static bool wait_for (eventcount& e, P pred, const std::chrono::milliseconds maxWait) {
+      if (Blocking) {
+        return pred() || e.await_for(pred, maxWait);
+      }
+      const auto deadline = std::chrono::steady_clock::now() + maxWait;
+      while (!pred()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+          return false;
+        }
+        std::this_thread::yield();
+      }
+      return true;
+    }
+
+    struct cell {
+      alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static constexpr std::size_t cache_line = 64;
+
+    // written by the consumer
+    alignas(cache_line) std::atomic<std::size_t> m_head;
+    std::size_t m_cached_tail;
+
+    // written by the producer
+    alignas(cache_line) std::atomic<std::size_t> m_tail;
+    std::size_t m_cached_head;
+
+    alignas(cache_line) const std::size_t m_mask;
+    const std::unique_ptr<cell[]> m_cells;
+
+    eventcount m_not_empty;
+    eventcount m_not_full;
+  };
+
+} // namespace util
@@ -23,6 +23,7 @@
 // Project includes
 //
 #include "string_util.h"
+#include "char_class.h"
 
 // --------------------------------------------------------------------------
 //
@@ -34,6 +35,7 @@
 #include <algorithm>
 #include <cctype>
 #include <cstring>
+#include <thread>
 #ifdef WIN32
 #define min min
 #define max max
@@ -67,22 +69,20 @@ namespace util {
       }
     }
 
-    bool starts_with (const std::string& str, const std::string& prefix) {
-      const int r = str.compare(0, prefix.length(), prefix);
-      return r == 0;
+    bool starts_with (std::string_view str, std::string_view prefix) {
+      return str.substr(0, prefix.size()) == prefix;
     }
 
-    bool ends_with (const std::string& str, const std::string& suffix) {
-      std::string::size_type l = str.length(), sl = suffix.length();
-      return (l >= sl) && (str.compare(l - sl, sl, suffix) == 0);
+    bool ends_with (std::string_view str, std::string_view suffix) {
+      return (str.size() >= suffix.size()) && (str.substr(str.size() - suffix.size()) == suffix);
     }
 
-    static const std::string white_space = " (){}[],.;:'\"!@#$%^&/*-+";
+    static constexpr char_class white_space(" (){}[],.;:'\"!@#$%^&/*-+");
 
     std::string::size_type find_left_space (const std::string& text, std::size_t cursor_pos) {
-      std::string::size_type pos = text.find_last_not_of(white_space, cursor_pos - 1);
+      std::string::size_type pos = find_last_not_in(text, white_space, cursor_pos - 1);
       if (pos != std::string::npos) {
-        std::string::size_type pos2 = text.find_last_of(white_space, pos);
+        std::string::size_type pos2 = find_last_in(text, white_space, pos);
         if (pos2 != std::string::npos) {
           return pos2 + 1;
         }
@@ -91,7 +91,7 @@ namespace util {
     }
 
     std::string::size_type find_right_space (const std::string& text, std::size_t cursor_pos) {
-      std::string::size_type pos = text.find_first_of(white_space, cursor_pos + 1);
+      std::string::size_type pos = find_first_in(text, white_space, cursor_pos + 1);
       if (pos != std::string::npos) {
         std::string::size_type pos2 = text.find_first_not_of(text[pos], pos);
         if (pos2 != std::string::npos) {
@@ -104,17 +104,55 @@ namespace util {
       }
     }
 
-    std::string merge (const std::vector<std::string>& v, const std::string& delimiter) {
-      std::ostringstream oss;
-      if (!v.empty()) {
-        std::copy(v.begin(), std::prev(v.end()), std::ostream_iterator<std::string>(oss, delimiter.c_str()));
-        oss << v.back();
+    namespace {
+
+      /// The chars isspace accepts in the "C" locale.
+      constexpr char_class space(" \t\n\v\f\r");
+
+    } // namespace
+
+    namespace detail {
+
+      void run_parallel (std::size_t count, const std::function<void(std::size_t)>& fn) {
+        std::vector<std::thread> threads;
+        threads.reserve(count - 1);
+        for (std::size_t i = 1; i < count; ++i) {
+          threads.emplace_back(fn, i);
+        }
+        fn(0);
+        for (auto& t : threads) {
+          t.join();
+        }
       }
-      return oss.str();
+
+      std::size_t merge_candidates (std::size_t items, std::size_t workers) {
+        if (!workers) {
+          workers = std::max(1U, std::thread::hardware_concurrency());
+        }
+        return std::max<std::size_t>(std::min(workers, items), 1);
+      }
+
+      std::size_t merge_slices (std::size_t bytes, std::size_t candidates) {
+        // Below a few MiB starting threads costs more than the copy.
+        const std::size_t min_slice_bytes = 1 << 20;
+        if (bytes < 4 * min_slice_bytes) {
+          return 1;
+        }
+        return std::min(candidates, bytes / min_slice_bytes);
+      }
+
+    } // namespace detail
+
+    std::string merge (const std::vector<std::string>& v, std::string_view delimiter) {
+      return merge<std::vector<std::string>>(v, delimiter);
+    }
+
+    std::string merge (const std::vector<std::string_view>& v, std::string_view delimiter) {
+      return merge<std::vector<std::string_view>>(v, delimiter);
     }
 
     void ltrim (std::string& s) {
-      s.erase(s.begin(), std::find_if_not(s.begin(), s.end(), isspace));
+      s.erase(0, find_first_not_in(s, space));
     }
 
     std::string ltrimed (std::string s) {
@@ -123,7 +161,8 @@ namespace util {
     }
 
     void rtrim (std::string& s) {
-      s.erase(std::find_if_not(s.rbegin(), s.rend(), isspace).base(), s.end());
+      const std::size_t last = find_last_not_in(s, space);
+      s.erase(last == std::string::npos ? 0 : last + 1);
     }
 
     std::string rtrimed (std::string s) {
@@ -132,8 +171,8 @@ namespace util {
     }
 
     void trim (std::string& s) {
-      ltrim(s);
       rtrim(s);
+      ltrim(s);
     }
 
     std::string trimed (std::string s) {
@@ -141,7 +180,24 @@ namespace util {
       return s;
     }
 
-    void replace (std::string& str, const std::string& from, const std::string& to) {
+    std::string_view ltrim_view (std::string_view s) {
+      s.remove_prefix(std::min(find_first_not_in(s, space), s.size()));
+      return s;
+    }
+
+    std::string_view rtrim_view (std::string_view s) {
+      const std::size_t last = find_last_not_in(s, space);
+      return s.substr(0, last == std::string_view::npos ? 0 : last + 1);
+    }
+
+    std::string_view trim_view (std::string_view s) {
+      return ltrim_view(rtrim_view(s));
+    }
+
+    void replace (std::string& str, std::string_view from, std::string_view to) {
+      if (from.empty()) {
+        return;
+      }
       size_t start_pos = 0;
       while ((start_pos = str.find(from, start_pos)) != std::string::npos) {
         str.replace(start_pos, from.length(), to);
@@ -150,16 +206,10 @@ namespace util {
     }
 
     void replace (std::string& str, const char* from, const char* to) {
-      size_t start_pos = 0;
-      size_t from_len = std::strlen(from);
-      size_t to_len = std::strlen(to);
-      while ((start_pos = str.find(from, start_pos)) != std::string::npos) {
-        str.replace(start_pos, from_len, to);
-        start_pos += to_len;
-      }
+      replace(str, std::string_view(from), std::string_view(to));
     }
 
-    std::string replaced (std::string s, const std::string& from, const std::string& to) {
+    std::string replaced (std::string s, std::string_view from, std::string_view to) {
       replace(s, from, to);
       return s;
     }
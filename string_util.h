@@ -23,8 +23,11 @@
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <string_view>
 #include <iomanip>
 #include <iterator>
+#include <functional>
+#include <type_traits>
 #include <vector>
 #include <cstdint>
 
@@ -50,8 +53,8 @@ namespace util {
     UTIL_EXPORT std::wstring utf8_to_utf16 (const std::string&);
 
     // --------------------------------------------------------------------------
-    UTIL_EXPORT bool starts_with (const std::string& str, const std::string& prefix);
-    UTIL_EXPORT bool ends_with (const std::string& str, const std::string& suffix);
+    UTIL_EXPORT bool starts_with (std::string_view str, std::string_view prefix);
+    UTIL_EXPORT bool ends_with (std::string_view str, std::string_view suffix);
 
     // --------------------------------------------------------------------------
     UTIL_EXPORT std::string::size_type find_left_space (const std::string& text, std::size_t cursor_pos);
@@ -67,22 +70,294 @@ namespace util {
       return is;
     }
 
+    // --------------------------------------------------------------------------
+    /**
+     * Lazy range over the tokens of a text separated by a delimiter of one or more chars.
+     * The tokens are views into the text, nothing is allocated or copied.
+     * Same rules as reading the text with getline: a trailing delimiter adds no
+     * empty token, a trailing new line adds one. An empty delimiter yields the whole text.
+     *
+     * for (std::string_view field : tokenize(line, ';')) ...
+     */
+    class split_range {
+    public:
+      class iterator {
+      public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::string_view value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const std::string_view* pointer;
+        typedef const std::string_view& reference;
+
+        iterator ()
+          : m_range(nullptr)
+          , m_next(0)
+          , m_state(state::done)
+        {}
+
+        reference operator* () const {
+          return m_token;
+        }
+
+        pointer operator-> () const {
+          return &m_token;
+        }
+
+        iterator& operator++ () {
+          advance();
+          return *this;
+        }
+
+        iterator operator++ (int) {
+          iterator i = *this;
+          advance();
+          return i;
+        }
+
+        bool operator== (const iterator& rhs) const {
+          return (m_state == rhs.m_state) &&
+                 ((m_state == state::done) || (m_token.data() == rhs.m_token.data()));
+        }
+
+        bool operator!= (const iterator& rhs) const {
+          return !operator==(rhs);
+        }
+
+      private:
+        friend class split_range;
+
+        enum class state : std::uint8_t {
+          token,
+          newline,
+          done
+        };
+
+        explicit iterator (const split_range* range)
+          : m_range(range)
+          , m_next(0)
+          , m_state(state::token)
+        {
+          advance();
+        }
+
+        void advance () {
+          const std::string_view text = m_range->m_text;
+          if (m_state == state::token) {
+            if (m_next < text.size()) {
+              const std::size_t end = m_range->find(m_next);
+              m_token = text.substr(m_next, end - m_next);
+              m_next = (end < text.size()) ? end + m_range->delimiter_size() : text.size();
+              return;
+            }
+            if (!text.empty() && (text.back() == '\n')) {
+              m_state = state::newline;
+              m_token = text.substr(text.size());
+              return;
+            }
+          }
+          m_state = state::done;
+          m_token = std::string_view();
+        }
+
+        const split_range* m_range;
+        std::string_view m_token;
+        std::size_t m_next;
+        state m_state;
+      };
+
+      typedef iterator const_iterator;
+
+      split_range (std::string_view text, std::string_view delimiter)
+        : m_text(text)
+        , m_delimiter(delimiter)
+        , m_char(delimiter.empty() ? '\0' : delimiter.front())
+        , m_single(delimiter.size() == 1)
+      {}
+
+      split_range (std::string_view text, char delimiter)
+        : m_text(text)
+        , m_char(delimiter)
+        , m_single(true)
+      {}
+
+      iterator begin () const {
+        return iterator(this);
+      }
+
+      iterator end () const {
+        return iterator();
+      }
+
+    private:
+      std::size_t delimiter_size () const {
+        return m_single ? 1 : m_delimiter.size();
+      }
+
+      /// @return the position of the next delimiter at or after pos, or the size of the text.
+      std::size_t find (std::size_t pos) const {
+        const char* first = m_text.data();
+        const std::size_t size = m_text.size();
+        if (m_single) {
+          const void* p = std::memchr(first + pos, m_char, size - pos);
+          return p ? static_cast<std::size_t>(static_cast<const char*>(p) - first) : size;
+        }
+        if (m_delimiter.empty()) {
+          return size;
+        }
+        const std::size_t rest = m_delimiter.size() - 1;
+        if (size - pos <= rest) {
+          return size;
+        }
+        // only a delimiter start that leaves room for the whole delimiter is a candidate
+        const char* last = first + size - rest;
+        for (const char* p = first + pos; p < last; ++p) {
+          p = static_cast<const char*>(std::memchr(p, m_char, static_cast<std::size_t>(last - p)));
+          if (!p) {
+            break;
+          }
+          if (std::memcmp(p + 1, m_delimiter.data() + 1, rest) == 0) {
+            return static_cast<std::size_t>(p - first);
+          }
+        }
+        return size;
+      }
+
+      std::string_view m_text;
+      std::string_view m_delimiter;
+      char m_char;
+      bool m_single;
+    };
+
+    /// Lazy tokens of text separated by delimiter, text and delimiter must outlive the range.
+    inline split_range tokenize (std::string_view text, std::string_view delimiter) {
+      return split_range(text, delimiter);
+    }
+
+    /// Lazy tokens of text separated by delimiter, text must outlive the range.
+    inline split_range tokenize (std::string_view text, char delimiter) {
+      return split_range(text, delimiter);
+    }
+
     template<char delimiter>
-    std::vector<std::string> split (const std::string& t) {
-      std::istringstream iss(t);
-      typedef std::istream_iterator<delimited<delimiter>> iterator;
-      std::vector<std::string> v(iterator{iss}, iterator{});
-      if (!t.empty() && (t.back() == '\n')) {
-        v.emplace_back(std::string());
+    std::vector<std::string> split (std::string_view t) {
+      std::vector<std::string> v;
+      for (std::string_view token : split_range(t, delimiter)) {
+        v.emplace_back(token);
       }
       return v;
     }
 
-    UTIL_EXPORT std::string merge (const std::vector<std::string>& v, const std::string& delimiter);
-
+    /// Like split, but the parts are views into t, no string is allocated.
     template<char delimiter>
-    std::string merge (const std::vector<std::string>& v) {
-      return merge(v, std::string(1, delimiter));
+    std::vector<std::string_view> split_view (std::string_view t) {
+      std::vector<std::string_view> v;
+      for (std::string_view token : split_range(t, delimiter)) {
+        v.push_back(token);
+      }
+      return v;
+    }
+
+    namespace detail {
+
+      /// Calls fn(i) for each i in [0, count), i = 0 on the calling thread, the others on own threads.
+      UTIL_EXPORT void run_parallel (std::size_t count, const std::function<void(std::size_t)>& fn);
+
+      /// @return the number of candidate slices for a parallel merge of items parts.
+      /// At most workers, 0 uses std::thread::hardware_concurrency().
+      UTIL_EXPORT std::size_t merge_candidates (std::size_t items, std::size_t workers);
+
+      /// @return the number of threads to fill a merge result of bytes, at most candidates, 1 for a serial fill.
+      UTIL_EXPORT std::size_t merge_slices (std::size_t bytes, std::size_t candidates);
+
+      /// Copies the parts [i, e) to out, each one preceded by delimiter if delimit_first or not the first.
+      template<typename I>
+      char* merge_fill (char* out, I i, I e, bool delimit_first, std::string_view delimiter) {
+        for (; i != e; ++i) {
+          if (delimit_first && !delimiter.empty()) {
+            std::memcpy(out, delimiter.data(), delimiter.size());
+            out += delimiter.size();
+          }
+          delimit_first = true;
+          const std::string_view part(*i);
+          // a default string_view has no data
+          if (!part.empty()) {
+            std::memcpy(out, part.data(), part.size());
+            out += part.size();
+          }
+        }
+        return out;
+      }
+
+    } // namespace detail
+
+    /**
+     * Joins the parts of a forward range of std::string, std::string_view or const char* with delimiter.
+     * The exact size is computed first, the result is allocated once and filled with memcpy.
+     * Large random access ranges are filled by up to workers threads, each copies a disjoint region,
+     * 0 workers uses std::thread::hardware_concurrency().
+     */
+    template<typename Range>
+    std::string merge (const Range& parts, std::string_view delimiter, std::size_t workers = 0) {
+      using std::begin;
+      using std::end;
+      const auto first = begin(parts);
+      const auto last = end(parts);
+      typedef std::decay_t<decltype(first)> iterator;
+      typedef typename std::iterator_traits<iterator>::iterator_category category;
+      constexpr bool random_access = std::is_base_of<std::random_access_iterator_tag, category>::value;
+
+      // The sizing pass records where each candidate slice starts in the result.
+      std::size_t items = 0;
+      std::size_t candidates = 1;
+      std::vector<std::size_t> offsets;
+      if constexpr (random_access) {
+        items = static_cast<std::size_t>(last - first);
+        candidates = detail::merge_candidates(items, workers);
+        if (candidates > 1) {
+          offsets.reserve(candidates);
+        }
+      }
+
+      std::size_t count = 0;
+      std::size_t bytes = 0;
+      for (auto i = first; i != last; ++i, ++count) {
+        if ((candidates > 1) && (offsets.size() < candidates) && (count == items * offsets.size() / candidates)) {
+          offsets.push_back(count ? bytes + (count - 1) * delimiter.size() : 0);
+        }
+        bytes += std::string_view(*i).size();
+      }
+      if (count == 0) {
+        return std::string();
+      }
+      bytes += (count - 1) * delimiter.size();
+
+      std::string result;
+      result.resize(bytes);
+      char* out = &result[0];
+      if constexpr (random_access) {
+        const std::size_t slices = detail::merge_slices(bytes, candidates);
+        if (slices > 1) {
+          detail::run_parallel(slices, [&] (std::size_t s) {
+            const std::size_t from = candidates * s / slices;
+            const std::size_t to = candidates * (s + 1) / slices;
+            const std::size_t begin_item = items * from / candidates;
+            const std::size_t end_item = items * to / candidates;
+            detail::merge_fill(out + offsets[from], first + begin_item, first + end_item, begin_item > 0, delimiter);
+          });
+          return result;
+        }
+      }
+      detail::merge_fill(out, first, last, false, delimiter);
+      return result;
+    }
+
+    UTIL_EXPORT std::string merge (const std::vector<std::string>& v, std::string_view delimiter);
+    UTIL_EXPORT std::string merge (const std::vector<std::string_view>& v, std::string_view delimiter);
+
+    template<char delimiter, typename Range>
+    std::string merge (const Range& parts) {
+      const char d = delimiter;
+      return merge(parts, std::string_view(&d, 1));
     }
 
     // trim front
@@ -97,11 +372,16 @@ namespace util {
     UTIL_EXPORT void trim (std::string& s);
     UTIL_EXPORT std::string trimed (std::string s);
 
+    // trim without copy, the result is a view into s
+    UTIL_EXPORT std::string_view ltrim_view (std::string_view s);
+    UTIL_EXPORT std::string_view rtrim_view (std::string_view s);
+    UTIL_EXPORT std::string_view trim_view (std::string_view s);
+
     // replace sequence in string
-    UTIL_EXPORT void replace (std::string& s, const std::string& from, const std::string& to);
+    UTIL_EXPORT void replace (std::string& s, std::string_view from, std::string_view to);
     UTIL_EXPORT void replace (std::string& s, const char* from, const char* to);
 
-    UTIL_EXPORT std::string replaced (std::string s, const std::string& from, const std::string& to);
+    UTIL_EXPORT std::string replaced (std::string s, std::string_view from, std::string_view to);
     UTIL_EXPORT std::string replaced (std::string s, const char* from, const char* to);
 
 #if defined(__cpp_lib_quoted_string_io)
@@ -207,6 +487,20 @@ namespace util {
         return s;
       }
 
+      // like to, but returns false if s could not be converted completely.
+      template<typename T>
+      inline bool try_to (const std::string& s, T& t) {
+        std::istringstream in(s);
+        in >> t;
+        return !in.fail() && (in >> std::ws).eof();
+      }
+
+      template<>
+      inline bool try_to<std::string> (const std::string& s, std::string& t) {
+        t = s;
+        return true;
+      }
+
     }
 
 
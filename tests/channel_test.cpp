@@ -0,0 +1,82 @@
+#include <util/channel.h>
+#include <testing/testing.h>
+
+#include <atomic>
+#include <thread>
+
+#ifdef UTIL_HAS_COROUTINES
+
+// --------------------------------------------------------------------------
+util::detached_task produce (util::channel<int>& c, int count, std::atomic<int>& done) {
+  for (int i = 1; i <= count; ++i) {
+    co_await c.send(i);
+  }
+  c.close();
+  ++done;
+}
+
+util::detached_task consume (util::channel<int>& c, std::atomic<long>& sum, std::atomic<int>& done) {
+  while (std::optional<int> i = co_await c.receive()) {
+    sum += *i;
+  }
+  ++done;
+}
+
+void wait_for (std::atomic<int>& done, int expected) {
+  while (done.load() < expected) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+// --------------------------------------------------------------------------
+void test_channel_coroutines () {
+  util::thread_pool pool(2);
+  util::channel<int> c(4, pool);
+  std::atomic<long> sum(0);
+  std::atomic<int> done(0);
+
+  for (int i = 0; i < 100; ++i) {
+    consume(c, sum, done);
+  }
+  produce(c, 10000, done);
+  wait_for(done, 101);
+
+  EXPECT_EQUAL(sum.load(), 10000L * 10001 / 2);
+  EXPECT_EQUAL(c.is_closed(), true);
+}
+
+// --------------------------------------------------------------------------
+void test_channel_close_wakes_senders () {
+  util::thread_pool pool(1);
+  util::channel<int> c(1, pool);
+  EXPECT_EQUAL(c.try_send(1), true);
+  EXPECT_EQUAL(c.try_send(2), false);
+
+  std::atomic<int> done(0);
+  std::atomic<bool> sent(true);
+  [] (util::channel<int>& c, std::atomic<bool>& sent, std::atomic<int>& done) -> util::detached_task {
+    sent = co_await c.send(3);
+    ++done;
+  } (c, sent, done);
+
+  c.close();
+  wait_for(done, 1);
+  EXPECT_EQUAL(sent.load(), false);
+  EXPECT_EQUAL(*c.try_receive(), 1);
+  EXPECT_EQUAL(c.try_receive().has_value(), false);
+}
+
+#endif // UTIL_HAS_COROUTINES
+
+// --------------------------------------------------------------------------
+void test_main (const testing::start_params&) {
+  testing::log_info("Running " __FILE__);
+#ifdef UTIL_HAS_COROUTINES
+  run_test(test_channel_coroutines);
+  run_test(test_channel_close_wakes_senders);
+#else
+  testing::log_info("No coroutine support, channel tests skipped");
+#endif
+}
+
+// --------------------------------------------------------------------------
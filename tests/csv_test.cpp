@@ -1,5 +1,10 @@
 
 #include <util/csv_reader.h>
+#include <util/csv_pipeline.h>
+#include <util/csv_ingest.h>
+#include <util/fs_util.h>
+#include <fstream>
+#include <atomic>
 #include <testing/testing.h>
 
 using namespace util::csv;
@@ -236,6 +241,188 @@ void test_parse_csv_tuple_skip_2 () {
 
 }
 
+// --------------------------------------------------------------------------
+void test_parse_csv_data_stats () {
+  using namespace util::csv;
+
+  const std::string text = "0123.456;'test'\n1234.567;\"foo\";bar";
+  std::istringstream buffer(text);
+  parse_stats stats;
+  int rows = 0;
+  read_csv_data(buffer, ';', false, [&] (const std::vector<std::string>&) {
+    ++rows;
+  }, stats);
+
+  EXPECT_EQUAL(rows, 2);
+  EXPECT_EQUAL(stats.rows, 2);
+  EXPECT_EQUAL(stats.fields, 5);
+  EXPECT_EQUAL(stats.quoted_fields, 2);
+  EXPECT_EQUAL(stats.bytes, text.size());
+  EXPECT_EQUAL(buffer.eof(), true);
+}
+
+// --------------------------------------------------------------------------
+void test_parse_csv_data_stats_stop () {
+  using namespace util::csv;
+
+  std::istringstream buffer("a;b\nc;d\ne;f\n");
+  parse_stats stats;
+  try {
+    read_csv_data(buffer, ';', false, [&] (const std::vector<std::string>&) {
+      throw std::runtime_error("stop");
+    }, stats);
+  } catch (const std::runtime_error&) {}
+
+  // the bytes read ahead are given back to the source stream
+  EXPECT_EQUAL(stats.rows, 1);
+  EXPECT_EQUAL(stats.bytes, 4);
+  std::string rest;
+  std::getline(buffer, rest);
+  EXPECT_EQUAL(rest, std::string("c;d"));
+}
+
+// --------------------------------------------------------------------------
+void test_parse_csv_tuple_stats () {
+  using namespace util::csv;
+  typedef tuple_reader<double, skip, int> test_reader;
+
+  const std::string text = "Eins;Zwei;Drei\n1.1;'x';2\n3.3;y;zwei\n;z;4";
+  std::istringstream buffer(text);
+  parse_stats stats;
+  int count = 0;
+  test_reader::read_csv(buffer, ';', true, [&](const test_reader::tuple& t) {
+    if (count == 1) {
+      EXPECT_EQUAL(std::get<0>(t), 3.3);
+      EXPECT_EQUAL(std::get<2>(t), 0);
+    }
+    ++count;
+  }, stats);
+
+  EXPECT_EQUAL(count, 3);
+  EXPECT_EQUAL(stats.rows, 3);
+  EXPECT_EQUAL(stats.fields, 9);
+  EXPECT_EQUAL(stats.quoted_fields, 1);
+  EXPECT_EQUAL(stats.conversion_failures, 1);
+  EXPECT_EQUAL(stats.bytes, text.size());
+}
+
+// --------------------------------------------------------------------------
+void test_write_csv_line () {
+  using namespace util::csv;
+
+  std::ostringstream buffer;
+  write_csv_line(buffer, {"1.5", "a;b", "'x", "say \"hi\""}, ';');
+
+  EXPECT_EQUAL(buffer.str(), std::string("1.5;\"a;b\";\"'x\";\"say \"\"hi\"\"\"\n"));
+
+  std::istringstream in(buffer.str());
+  std::vector<std::string> expected = {"1.5", "a;b", "'x", "say \"hi\""};
+  EXPECT_EQUAL(parse_csv_line(in), expected);
+}
+
+// --------------------------------------------------------------------------
+void test_transform_csv_data () {
+  using namespace util::csv;
+
+  std::ostringstream input;
+  input << "Nr;Value\n";
+  for (int i = 0; i < 1000; ++i) {
+    input << i << ';' << i * 0.5 << '\n';
+  }
+  std::istringstream in(input.str());
+  std::ostringstream out;
+
+  transform_options options;
+  options.workers = 4;
+  options.batch_size = 7;
+  transform_csv_data(in, out, ';', true, [] (std::vector<std::string>& row) {
+    row[1] = util::string::convert::from(util::string::convert::to<double>(row[1]) * 2);
+  }, options);
+
+  std::ostringstream expected;
+  expected << "Nr;Value\n";
+  for (int i = 0; i < 1000; ++i) {
+    expected << i << ';' << i << '\n';
+  }
+  EXPECT_EQUAL(out.str(), expected.str());
+}
+
+// --------------------------------------------------------------------------
+void test_transform_csv_data_throw () {
+  using namespace util::csv;
+
+  std::ostringstream input;
+  input << "Nr;Value\n";
+  for (int i = 0; i < 1000; ++i) {
+    input << i << ";a\n";
+  }
+  std::istringstream in(input.str());
+  std::ostringstream out;
+
+  transform_options options;
+  options.workers = 4;
+  options.batch_size = 10;
+  bool thrown = false;
+  try {
+    transform_csv_data(in, out, ';', true, [] (std::vector<std::string>& row) {
+      if (row[0] == "503") {
+        throw std::runtime_error("bad row");
+      }
+      row[1] = "b";
+    }, options);
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  EXPECT_EQUAL(thrown, true);
+
+  // Rows 500 - 509 are the failing batch, only the batches before it are written.
+  std::ostringstream expected;
+  expected << "Nr;Value\n";
+  for (int i = 0; i < 500; ++i) {
+    expected << i << ";b\n";
+  }
+  EXPECT_EQUAL(out.str(), expected.str());
+}
+
+// --------------------------------------------------------------------------
+void test_ingest_csv_files () {
+  using namespace util::csv;
+
+  const sys_fs::path dir = sys_fs::temp_directory_path() / "util_csv_ingest_test";
+  sys_fs::create_directories(dir);
+  long expected = 0;
+  for (int f = 0; f < 5; ++f) {
+    std::ofstream out(dir / ostreamfmt("part" << f << ".csv"));
+    out << "Nr;Value\n";
+    for (int i = 0; i < f * 300; ++i) {
+      out << i << ";'v" << i << "'\r\n";
+      expected += i;
+    }
+  }
+  std::ofstream(dir / "other.txt") << "1;2\n";
+
+  ingest_options options;
+  options.workers = 3;
+  options.chunk_size = 256;
+  long sum = ingest_csv_files(util::fs::find_files(dir, "part*.csv"), ';', true, 0L,
+                              [] (long& acc, const std::vector<std::string>& row) {
+    acc += util::string::convert::to<long>(row[0]);
+  }, [] (long& into, long&& from) {
+    into += from;
+  }, options);
+  EXPECT_EQUAL(sum, expected);
+
+  std::atomic<long> rows(0);
+  ingest_csv_files(dir, "*.csv", ';', true, [&] (const std::vector<std::string>& row, std::size_t worker) {
+    EXPECT_EQUAL(row.size(), 2);
+    EXPECT_EQUAL(worker < 3, true);
+    ++rows;
+  }, options);
+  EXPECT_EQUAL(rows.load(), 3000L);
+
+  sys_fs::remove_all(dir);
+}
+
 // --------------------------------------------------------------------------
 void test_main (const testing::start_params&) {
   testing::log_info("Running " __FILE__);
@@ -253,6 +440,13 @@ void test_main (const testing::start_params&) {
   run_test(test_parse_csv_tuple_cut);
   run_test(test_parse_csv_tuple_skip_1);
   run_test(test_parse_csv_tuple_skip_2);
+  run_test(test_parse_csv_data_stats);
+  run_test(test_parse_csv_data_stats_stop);
+  run_test(test_parse_csv_tuple_stats);
+  run_test(test_write_csv_line);
+  run_test(test_transform_csv_data);
+  run_test(test_transform_csv_data_throw);
+  run_test(test_ingest_csv_files);
 }
 
 // --------------------------------------------------------------------------
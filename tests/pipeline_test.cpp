@@ -0,0 +1,85 @@
+#include <util/pipeline.h>
+#include <testing/testing.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+// --------------------------------------------------------------------------
+void test_pipeline_stages () {
+  std::atomic<long> sum(0);
+  auto p = util::make_pipeline<int>()
+             .then("parse", [] (int i) { return std::to_string(i); }, {2, 8, 4})
+             .then("transform", [] (std::string&& s) { return std::stol(s) * 2; }, {3, 1, 2})
+             .sink("write", [&] (long l) { sum += l; });
+  p.start();
+  for (int i = 1; i <= 1000; ++i) {
+    EXPECT_EQUAL(p.push(i), true);
+  }
+  p.close();
+  p.wait();
+  EXPECT_EQUAL(p.push(1), false);
+  EXPECT_EQUAL(sum.load(), 1000L * 1001);
+
+  const std::vector<util::stage_stats> stats = p.stats();
+  EXPECT_EQUAL(stats.size(), 3);
+  EXPECT_EQUAL(stats[0].name, std::string("parse"));
+  EXPECT_EQUAL(stats[1].workers, 3);
+  for (const auto& s : stats) {
+    EXPECT_EQUAL(s.items, 1000);
+    EXPECT_EQUAL(s.errors, 0);
+    EXPECT_EQUAL(s.queued, 0);
+    EXPECT_EQUAL(s.throughput() > 0, true);
+  }
+  EXPECT_EQUAL(stats[0].batches <= 1000, true);
+  EXPECT_EQUAL(stats[1].batches, 1000);
+}
+
+// --------------------------------------------------------------------------
+void test_pipeline_error () {
+  std::atomic<int> written(0);
+  auto p = util::make_pipeline<int>()
+             .then("check", [] (int i) {
+               if (i == 3) {
+                 throw std::runtime_error("bad item");
+               }
+               return i;
+             })
+             .sink("write", [&] (int) { ++written; });
+  p.start();
+  for (int i = 0; i < 10; ++i) {
+    p.push(i);
+  }
+  p.close();
+  bool thrown = false;
+  try {
+    p.wait();
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  EXPECT_EQUAL(thrown, true);
+  EXPECT_EQUAL(written.load(), 9);
+  EXPECT_EQUAL(p.stats()[0].errors, 1);
+}
+
+// --------------------------------------------------------------------------
+void test_pipeline_destructor_closes () {
+  std::atomic<int> written(0);
+  {
+    auto p = util::make_pipeline<int>().sink("write", [&] (int) { ++written; });
+    p.start();
+    p.push(1);
+    p.push(2);
+  }
+  EXPECT_EQUAL(written.load(), 2);
+}
+
+// --------------------------------------------------------------------------
+void test_main (const testing::start_params&) {
+  testing::log_info("Running " __FILE__);
+  run_test(test_pipeline_stages);
+  run_test(test_pipeline_error);
+  run_test(test_pipeline_destructor_closes);
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,743 @@
+#include <util/blocking_queue.h>
+#include <util/bounded_queue.h>
+#include <util/delay_queue.h>
+#include <util/latest_value.h>
+#include <util/mpmc_queue.h>
+#include <util/multicast_ring.h>
+#include <util/priority_blocking_queue.h>
+#include <util/sharded_queue.h>
+#include <util/spsc_queue.h>
+#include <testing/testing.h>
+
+#include <optional>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------------------------
+template<typename Q>
+void produce_consume (Q& queue, int producers, int consumers, int count) {
+  std::atomic<long> sum(0);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p] () {
+      for (int i = 1; i <= count; ++i) {
+        queue.enqueue(i);
+      }
+    });
+  }
+  for (int c = 0; c < consumers; ++c) {
+    threads.emplace_back([&, c] () {
+      const int n = (producers * count) / consumers + (c < (producers * count) % consumers ? 1 : 0);
+      for (int i = 0; i < n; ++i) {
+        sum += queue.dequeue();
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQUAL(sum.load(), static_cast<long>(producers) * count * (count + 1) / 2);
+  EXPECT_EQUAL(queue.isEmpty(), true);
+}
+
+// --------------------------------------------------------------------------
+void test_blocking_bulk () {
+  util::blocking_queue<int> queue;
+  std::vector<int> in = {1, 2, 3, 4, 5};
+  queue.enqueue(in.begin(), in.end());
+
+  std::vector<int> out;
+  EXPECT_EQUAL(queue.try_dequeue_bulk(std::back_inserter(out), 3), 3);
+  EXPECT_EQUAL(queue.dequeue_bulk(std::back_inserter(out), 3, std::chrono::milliseconds(1)), 2);
+  EXPECT_EQUAL(queue.dequeue_bulk(std::back_inserter(out), 3, std::chrono::milliseconds(1)), 0);
+  EXPECT_EQUAL(queue.try_dequeue_bulk(std::back_inserter(out), 3), 0);
+  EXPECT_EQUAL(out == in, true);
+
+  int buffer[4] = {};
+  queue.enqueue(7);
+  EXPECT_EQUAL(queue.dequeue_bulk(buffer, 4), 1);
+  EXPECT_EQUAL(buffer[0], 7);
+}
+
+// --------------------------------------------------------------------------
+void test_blocking_bulk_threads () {
+  util::blocking_queue<int> queue;
+  std::atomic<long> sum(0);
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < 3; ++c) {
+    consumers.emplace_back([&] () {
+      int buffer[64];
+      for (;;) {
+        const std::size_t n = queue.dequeue_bulk(buffer, 64);
+        int stops = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+          stops += (buffer[i] == 0);
+          sum += buffer[i];
+        }
+        if (stops) {
+          // hand the stop marks of the other consumers back
+          for (int i = 1; i < stops; ++i) {
+            queue.enqueue(0);
+          }
+          return;
+        }
+      }
+    });
+  }
+  for (int i = 1; i <= 10000; ++i) {
+    queue.enqueue(i);
+  }
+  queue.wait_until_empty(std::chrono::milliseconds(1000));
+  for (int c = 0; c < 3; ++c) {
+    queue.enqueue(0);
+  }
+  for (auto& t : consumers) {
+    t.join();
+  }
+  EXPECT_EQUAL(sum.load(), 10000L * 10001 / 2);
+}
+
+// --------------------------------------------------------------------------
+void test_blocking_spinning () {
+  typedef util::blocking_queue<int, 1 << 20, util::spin_then_park<100, 10>> queue_type;
+  queue_type queue;
+  EXPECT_EQUAL(queue.dequeue(std::chrono::milliseconds(1)), 0);
+  produce_consume(queue, 2, 2, 20000);
+
+  queue_type closing;
+  std::thread consumer([&] () {
+    EXPECT_EQUAL(closing.pop().has_value(), false);
+  });
+  closing.close();
+  consumer.join();
+}
+
+// --------------------------------------------------------------------------
+void test_blocking_metrics () {
+  util::blocking_queue<int, 3, util::park_wait, util::queue_metrics> queue;
+  std::vector<int> in = {1, 2, 3, 4};
+  queue.enqueue(in.begin(), in.end());
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  EXPECT_EQUAL(queue.dequeue(), 2);
+
+  util::queue_stats stats = queue.stats();
+  EXPECT_EQUAL(stats.enqueued, 4);
+  EXPECT_EQUAL(stats.discarded, 1);
+  EXPECT_EQUAL(stats.dequeued, 1);
+  EXPECT_EQUAL(stats.high_water, 3);
+  EXPECT_EQUAL(stats.depth, 2);
+  EXPECT_EQUAL(stats.max_latency >= std::chrono::milliseconds(2), true);
+  EXPECT_EQUAL(stats.mean_latency() == stats.max_latency, true);
+  EXPECT_EQUAL(stats.locks, 2);
+
+  queue.clear();
+  EXPECT_EQUAL(queue.dequeue(std::chrono::milliseconds(2)), 0);
+  stats = queue.stats();
+  EXPECT_EQUAL(stats.discarded, 3);
+  EXPECT_EQUAL(stats.depth, 0);
+  EXPECT_EQUAL(stats.idle_time >= std::chrono::milliseconds(2), true);
+
+  queue.reset_stats();
+  EXPECT_EQUAL(queue.stats().enqueued, 0);
+  EXPECT_EQUAL(sizeof(util::blocking_queue<int>) < sizeof(queue), true);
+
+  util::blocking_queue<int, 1 << 20, util::park_wait, util::queue_metrics> busy;
+  produce_consume(busy, 2, 2, 10000);
+  stats = busy.stats();
+  EXPECT_EQUAL(stats.enqueued, 20000);
+  EXPECT_EQUAL(stats.dequeued, 20000);
+  EXPECT_EQUAL(stats.contended_locks <= stats.locks, true);
+}
+
+// --------------------------------------------------------------------------
+void test_blocking_close () {
+  util::blocking_queue<std::unique_ptr<int>> queue;
+  EXPECT_EQUAL(queue.enqueue(std::make_unique<int>(1)), true);
+  EXPECT_EQUAL(queue.emplace(new int(2)), true);
+  queue.close();
+  EXPECT_EQUAL(queue.is_closed(), true);
+  EXPECT_EQUAL(queue.enqueue(std::make_unique<int>(3)), false);
+
+  std::optional<std::unique_ptr<int>> p = queue.pop();
+  EXPECT_EQUAL(**p, 1);
+  p = queue.try_pop();
+  EXPECT_EQUAL(**p, 2);
+  EXPECT_EQUAL(queue.pop().has_value(), false);
+  EXPECT_EQUAL(queue.pop(std::chrono::milliseconds(1)).has_value(), false);
+}
+
+// --------------------------------------------------------------------------
+void test_close_wakes_waiters () {
+  util::blocking_queue<int> unbounded;
+  util::bounded_queue<int> bounded(1);
+  bounded.enqueue(1);
+
+  std::atomic<int> done(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 3; ++i) {
+    threads.emplace_back([&] () {
+      while (unbounded.pop()) {}
+      ++done;
+    });
+  }
+  threads.emplace_back([&] () {
+    EXPECT_EQUAL(bounded.enqueue(2), false);
+    ++done;
+  });
+  unbounded.enqueue(1);
+  unbounded.close();
+  bounded.close();
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQUAL(done.load(), 4);
+  EXPECT_EQUAL(*bounded.pop(), 1);
+  EXPECT_EQUAL(bounded.pop().has_value(), false);
+  EXPECT_EQUAL(bounded.try_pop().has_value(), false);
+}
+
+// --------------------------------------------------------------------------
+void test_bounded_overflow () {
+  util::bounded_queue<int, util::overflow::drop_newest> newest(2);
+  EXPECT_EQUAL(newest.enqueue(1), true);
+  EXPECT_EQUAL(newest.enqueue(2), true);
+  EXPECT_EQUAL(newest.enqueue(3), false);
+  EXPECT_EQUAL(newest.dropped(), 1);
+  EXPECT_EQUAL(newest.dequeue(), 1);
+  EXPECT_EQUAL(newest.dequeue(), 2);
+
+  util::bounded_queue<int, util::overflow::drop_oldest> oldest(2);
+  EXPECT_EQUAL(oldest.enqueue(1), true);
+  EXPECT_EQUAL(oldest.enqueue(2), true);
+  EXPECT_EQUAL(oldest.enqueue(3), true);
+  EXPECT_EQUAL(oldest.dropped(), 1);
+  EXPECT_EQUAL(oldest.dequeue(), 2);
+  EXPECT_EQUAL(oldest.dequeue(), 3);
+
+  util::bounded_queue<int> block(2);
+  EXPECT_EQUAL(block.try_enqueue(1), true);
+  EXPECT_EQUAL(block.try_enqueue(2), true);
+  EXPECT_EQUAL(block.try_enqueue(3), false);
+  EXPECT_EQUAL(block.enqueue(3, std::chrono::milliseconds(1)), false);
+  EXPECT_EQUAL(block.dropped(), 0);
+  EXPECT_EQUAL(block.size(), 2);
+
+  const int items[] = {4, 5};
+  const int value = 6;
+  block.clear();
+  EXPECT_EQUAL(block.enqueue(std::begin(items), std::end(items)), true);
+  EXPECT_EQUAL(block.try_enqueue(value), false);
+  block.close();
+  EXPECT_EQUAL(block.enqueue(std::begin(items), std::end(items)), false);
+}
+
+// --------------------------------------------------------------------------
+void test_bounded_empty_waiter () {
+  util::bounded_queue<int> queue(2);
+  queue.enqueue(1);
+  queue.enqueue(2);
+
+  std::thread waiter([&] () {
+    queue.wait_until_empty(std::chrono::seconds(10));
+  });
+  std::thread producer([&] () {
+    queue.enqueue(3);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  // The free slot must wake the producer, not the thread waiting for an empty queue.
+  EXPECT_EQUAL(queue.dequeue(), 1);
+  producer.join();
+  EXPECT_EQUAL(queue.size(), 2);
+  EXPECT_EQUAL(queue.dequeue(), 2);
+  EXPECT_EQUAL(queue.dequeue(), 3);
+  waiter.join();
+}
+
+// --------------------------------------------------------------------------
+void test_bounded_not_empty_watcher () {
+  typedef std::chrono::steady_clock clock;
+  util::bounded_queue<int> queue(4);
+
+  std::thread watcher([&] () {
+    queue.wait_until_not_empty(std::chrono::seconds(10));
+  });
+  std::optional<int> item;
+  clock::duration waited = {};
+  std::thread consumer([&] () {
+    const auto start = clock::now();
+    item = queue.pop(std::chrono::seconds(2));
+    waited = clock::now() - start;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  // The item must wake the consumer, even if the watcher is woken as well.
+  queue.enqueue(1);
+  consumer.join();
+  watcher.join();
+  EXPECT_EQUAL(item.value_or(0), 1);
+  EXPECT_EQUAL(waited < std::chrono::seconds(1), true);
+
+  const int items[] = {2, 3, 4, 5, 6, 7};
+  std::vector<int> out;
+  std::thread taker([&] () {
+    while (auto i = queue.pop()) {
+      out.push_back(*i);
+    }
+  });
+  EXPECT_EQUAL(queue.enqueue(std::begin(items), std::end(items)), true);
+  queue.close();
+  taker.join();
+  EXPECT_EQUAL(out == std::vector<int>({2, 3, 4, 5, 6, 7}), true);
+}
+
+// --------------------------------------------------------------------------
+void test_bounded_threads () {
+  util::bounded_queue<int> queue(8);
+  produce_consume(queue, 4, 2, 10000);
+}
+
+// --------------------------------------------------------------------------
+void test_delay_order () {
+  typedef util::delay_queue<int>::clock clock;
+  util::delay_queue<int> queue;
+  const auto start = clock::now();
+  queue.enqueue(start + std::chrono::milliseconds(30), 3);
+  queue.enqueue_after(std::chrono::milliseconds(10), 1);
+  queue.enqueue(start + std::chrono::milliseconds(30), 4);
+  queue.enqueue(start, 0);
+  EXPECT_EQUAL(queue.size(), 4);
+
+  EXPECT_EQUAL(*queue.try_pop(), 0);
+  EXPECT_EQUAL(queue.try_pop().has_value(), false);
+  EXPECT_EQUAL(queue.pop(std::chrono::milliseconds(1)).has_value(), false);
+  EXPECT_EQUAL(*queue.pop(), 1);
+  EXPECT_EQUAL(clock::now() - start >= std::chrono::milliseconds(10), true);
+  queue.close();
+  EXPECT_EQUAL(queue.enqueue(start, 5), false);
+  EXPECT_EQUAL(*queue.pop(), 3);
+  EXPECT_EQUAL(*queue.pop(), 4);
+  EXPECT_EQUAL(clock::now() - start >= std::chrono::milliseconds(30), true);
+  EXPECT_EQUAL(queue.pop().has_value(), false);
+}
+
+// --------------------------------------------------------------------------
+void test_delay_earlier_wakes () {
+  typedef util::delay_queue<int>::clock clock;
+  util::delay_queue<int> queue;
+  queue.enqueue_after(std::chrono::seconds(10), 2);
+
+  std::vector<int> out;
+  std::thread consumer([&] () {
+    while (auto i = queue.pop()) {
+      out.push_back(*i);
+      if (*i == 1) {
+        queue.clear();
+        queue.close();
+      }
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  const auto start = clock::now();
+  queue.enqueue_after(std::chrono::milliseconds(5), 1);
+  consumer.join();
+  EXPECT_EQUAL(clock::now() - start < std::chrono::seconds(5), true);
+  EXPECT_EQUAL(out == std::vector<int>({1}), true);
+}
+
+// --------------------------------------------------------------------------
+void test_delay_grow_while_waiting () {
+  util::delay_queue<int> queue;
+  queue.enqueue_after(std::chrono::milliseconds(50), 0);
+
+  std::vector<int> out;
+  std::thread consumer([&] () {
+    while (auto i = queue.pop(std::chrono::seconds(5))) {
+      out.push_back(*i);
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  // Later items do not wake the consumer, but reallocate the heap it waits on.
+  for (int i = 1; i <= 1000; ++i) {
+    queue.enqueue_after(std::chrono::milliseconds(60), i);
+  }
+  queue.close();
+  consumer.join();
+  EXPECT_EQUAL(out.size(), 1001);
+  EXPECT_EQUAL(out.front(), 0);
+}
+
+// --------------------------------------------------------------------------
+struct sample {
+  long a;
+  long b;
+  char tag[20];
+};
+
+void test_latest_value () {
+  util::latest_value<sample> cell;
+  util::latest_value<sample>::version_type version = 0;
+  sample s = cell.load(version);
+  EXPECT_EQUAL(version, 0);
+  EXPECT_EQUAL(s.a, 0);
+  EXPECT_EQUAL(cell.try_load_newer(version, s), false);
+  EXPECT_EQUAL(cell.wait_newer(version, std::chrono::milliseconds(1)).has_value(), false);
+
+  EXPECT_EQUAL(cell.store({1, -1, "one"}), 1);
+  EXPECT_EQUAL(cell.store({2, -2, "two"}), 2);
+  EXPECT_EQUAL(cell.try_load_newer(version, s), true);
+  EXPECT_EQUAL(version, 2);
+  EXPECT_EQUAL(s.a, 2);
+  EXPECT_EQUAL(std::string(s.tag), std::string("two"));
+
+  // readers must never see a torn value
+  std::atomic<bool> torn(false);
+  std::thread reader([&] () {
+    util::latest_value<sample>::version_type v = version;
+    for (;;) {
+      const sample r = cell.wait_newer(v);
+      if (r.a != -r.b) {
+        torn = true;
+      }
+      if (r.a == 100000) {
+        break;
+      }
+    }
+  });
+  std::thread writer([&] () {
+    for (long i = 3; i <= 100000; ++i) {
+      cell.store({i, -i, "x"});
+    }
+  });
+  writer.join();
+  reader.join();
+  EXPECT_EQUAL(torn.load(), false);
+  EXPECT_EQUAL(cell.version(), 100000);
+}
+
+// --------------------------------------------------------------------------
+void test_mpmc_fifo () {
+  util::mpmc_queue<int> queue(3);
+  EXPECT_EQUAL(queue.capacity(), 4);
+
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQUAL(queue.try_enqueue(i), true);
+  }
+  EXPECT_EQUAL(queue.try_enqueue(4), false);
+  EXPECT_EQUAL(queue.size(), 4);
+
+  int i = -1;
+  EXPECT_EQUAL(queue.try_dequeue(i), true);
+  EXPECT_EQUAL(i, 0);
+  EXPECT_EQUAL(queue.dequeue(), 1);
+  EXPECT_EQUAL(queue.dequeue(std::chrono::milliseconds(1)), 2);
+  EXPECT_EQUAL(queue.dequeue(), 3);
+  EXPECT_EQUAL(queue.dequeue(std::chrono::milliseconds(1)), 0);
+  EXPECT_EQUAL(queue.try_dequeue(i), false);
+}
+
+// --------------------------------------------------------------------------
+void test_mpmc_threads () {
+  util::mpmc_queue<int> queue(16);
+  produce_consume(queue, 4, 3, 20000);
+
+  util::mpmc_queue<int, util::spin_then_park<>> spinning(16);
+  produce_consume(spinning, 3, 3, 20000);
+}
+
+// --------------------------------------------------------------------------
+struct no_default {
+  explicit no_default (int v)
+    : value(v)
+  {}
+
+  int value;
+};
+
+void test_mpmc_no_default () {
+  util::mpmc_queue<no_default> queue(4);
+  queue.enqueue(no_default(1));
+  queue.enqueue(no_default(2));
+  EXPECT_EQUAL(queue.dequeue().value, 1);
+  EXPECT_EQUAL(queue.size(), 1);
+}
+
+// --------------------------------------------------------------------------
+void test_mpmc_not_empty_watcher () {
+  typedef std::chrono::steady_clock clock;
+  util::mpmc_queue<int> queue(4);
+
+  std::thread watcher([&] () {
+    queue.wait_until_not_empty(std::chrono::seconds(10));
+  });
+  int item = 0;
+  clock::duration waited = {};
+  std::thread consumer([&] () {
+    const auto start = clock::now();
+    item = queue.dequeue(std::chrono::seconds(2));
+    waited = clock::now() - start;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  queue.enqueue(1);
+  consumer.join();
+  watcher.join();
+  EXPECT_EQUAL(item, 1);
+  EXPECT_EQUAL(waited < std::chrono::seconds(1), true);
+}
+
+// --------------------------------------------------------------------------
+void test_multicast_ring () {
+  typedef util::multicast_ring<long> ring_type;
+  ring_type ring(8);
+  EXPECT_EQUAL(ring.capacity(), 8);
+  ring_type::consumer& persist = ring.add_consumer();
+  ring_type::consumer& metrics = ring.add_consumer();
+  ring_type::consumer& forward = ring.add_consumer({&persist});
+
+  const long count = 10000;
+  long persisted = 0, counted = 0, forwarded = 0;
+  bool ordered = true;
+
+  std::thread persister([&] () {
+    while (persist.consume([&] (const long& e, ring_type::sequence_type) { persisted += e; })) {}
+  });
+  std::thread counter([&] () {
+    while (metrics.consume([&] (const long&, ring_type::sequence_type) { ++counted; }, 3)) {}
+  });
+  std::thread forwarder([&] () {
+    while (forward.consume([&] (const long& e, ring_type::sequence_type seq) {
+      if (persist.position() <= seq) {
+        ordered = false;
+      }
+      forwarded += e;
+    })) {}
+  });
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < 2; ++p) {
+    producers.emplace_back([&] () {
+      for (long i = 1; i <= count; ++i) {
+        ring.publish_with([i] (long& e, ring_type::sequence_type) { e = i; });
+      }
+    });
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  ring.close();
+  EXPECT_EQUAL(ring.publish(1), false);
+  persister.join();
+  counter.join();
+  forwarder.join();
+
+  EXPECT_EQUAL(persisted, count * (count + 1));
+  EXPECT_EQUAL(forwarded, count * (count + 1));
+  EXPECT_EQUAL(counted, 2 * count);
+  EXPECT_EQUAL(ordered, true);
+  EXPECT_EQUAL(forward.position(), 2 * count);
+}
+
+// --------------------------------------------------------------------------
+void test_priority_bands () {
+  util::priority_blocking_queue<int> queue(3);
+  queue.enqueue(2, 20);
+  queue.enqueue(1, 10);
+  queue.enqueue(7, 21);
+  queue.emplace(0, 1);
+  queue.enqueue(1, 11);
+  EXPECT_EQUAL(queue.size(), 5);
+  EXPECT_EQUAL(queue.size(2), 2);
+
+  std::vector<int> out;
+  int i = 0;
+  while (queue.try_dequeue(i)) {
+    out.push_back(i);
+  }
+  EXPECT_EQUAL(out == std::vector<int>({1, 10, 11, 20, 21}), true);
+  EXPECT_EQUAL(queue.pop(std::chrono::milliseconds(1)).has_value(), false);
+}
+
+// --------------------------------------------------------------------------
+void test_priority_grow () {
+  util::priority_blocking_queue<std::string> queue(2);
+  // wrap around the band ring before it has to grow
+  for (int i = 0; i < 10; ++i) {
+    queue.enqueue(1, std::to_string(i));
+  }
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQUAL(*queue.try_pop(), std::to_string(i));
+  }
+  for (int i = 0; i < 100; ++i) {
+    queue.enqueue(1, std::to_string(i));
+  }
+  queue.enqueue(0, "first");
+  EXPECT_EQUAL(queue.size(1), 100);
+  EXPECT_EQUAL(*queue.try_pop(), std::string("first"));
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQUAL(*queue.try_pop(), std::to_string(i));
+  }
+  EXPECT_EQUAL(queue.isEmpty(), true);
+}
+
+// --------------------------------------------------------------------------
+void test_priority_aging () {
+  util::priority_blocking_queue<int> queue(2, std::chrono::milliseconds(5));
+  queue.enqueue(1, 100);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  queue.enqueue(0, 1);
+  queue.enqueue(0, 2);
+  EXPECT_EQUAL(queue.dequeue(), 100);
+  EXPECT_EQUAL(queue.dequeue(), 1);
+  queue.close();
+  EXPECT_EQUAL(*queue.pop(), 2);
+  EXPECT_EQUAL(queue.pop().has_value(), false);
+}
+
+// --------------------------------------------------------------------------
+void test_priority_threads () {
+  util::priority_blocking_queue<int> queue(4, std::chrono::milliseconds(1));
+  std::atomic<long> sum(0);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < 4; ++p) {
+    threads.emplace_back([&, p] () {
+      for (int i = 1; i <= 20000; ++i) {
+        queue.enqueue(p, i);
+      }
+    });
+  }
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < 3; ++c) {
+    consumers.emplace_back([&] () {
+      while (auto i = queue.pop()) {
+        sum += *i;
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  queue.close();
+  for (auto& t : consumers) {
+    t.join();
+  }
+  EXPECT_EQUAL(sum.load(), 4L * 20000 * 20001 / 2);
+  EXPECT_EQUAL(queue.isEmpty(), true);
+}
+
+// --------------------------------------------------------------------------
+void test_sharded_bulk () {
+  util::sharded_queue<int> queue(3);
+  EXPECT_EQUAL(queue.lanes(), 4);
+  std::vector<int> in = {1, 2, 3, 4, 5};
+  queue.enqueue(in.begin(), in.end());
+  queue.emplace(6);
+  EXPECT_EQUAL(queue.size(), 6);
+
+  std::vector<int> out;
+  EXPECT_EQUAL(queue.try_dequeue_bulk(std::back_inserter(out), 4), 4);
+  EXPECT_EQUAL(queue.dequeue_bulk(std::back_inserter(out), 4, std::chrono::milliseconds(1)), 2);
+  EXPECT_EQUAL(out == std::vector<int>({1, 2, 3, 4, 5, 6}), true);
+  EXPECT_EQUAL(queue.pop(std::chrono::milliseconds(1)).has_value(), false);
+
+  queue.enqueue(7);
+  queue.close();
+  EXPECT_EQUAL(queue.enqueue(8), false);
+  EXPECT_EQUAL(*queue.pop(), 7);
+  EXPECT_EQUAL(queue.pop().has_value(), false);
+}
+
+// --------------------------------------------------------------------------
+void test_sharded_fan_in () {
+  util::sharded_queue<int> queue(4);
+  produce_consume(queue, 8, 2, 10000);
+
+  const int producers = 8, count = 10000;
+  std::atomic<long> sum(0);
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < 2; ++c) {
+    consumers.emplace_back([&] () {
+      int buffer[64];
+      while (std::size_t n = queue.dequeue_bulk(buffer, 64)) {
+        for (std::size_t i = 0; i < n; ++i) {
+          sum += buffer[i] % count;
+        }
+      }
+    });
+  }
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p] () {
+      for (int i = 1; i < count; ++i) {
+        queue.enqueue(p * count + i);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  queue.close();
+  for (auto& t : consumers) {
+    t.join();
+  }
+  EXPECT_EQUAL(sum.load(), static_cast<long>(producers) * count * (count - 1) / 2);
+}
+
+// --------------------------------------------------------------------------
+void test_spsc_move_only () {
+  util::spsc_queue<std::unique_ptr<int>> queue(2);
+  EXPECT_EQUAL(queue.try_enqueue(std::make_unique<int>(1)), true);
+  EXPECT_EQUAL(queue.try_emplace(new int(2)), true);
+  EXPECT_EQUAL(queue.try_enqueue(std::make_unique<int>(3)), false);
+
+  EXPECT_EQUAL(**queue.front(), 1);
+  queue.pop();
+  std::unique_ptr<int> p;
+  EXPECT_EQUAL(queue.try_dequeue(p), true);
+  EXPECT_EQUAL(*p, 2);
+  EXPECT_EQUAL(queue.front() == nullptr, true);
+  EXPECT_EQUAL(queue.dequeue(std::chrono::milliseconds(1)) == nullptr, true);
+}
+
+// --------------------------------------------------------------------------
+void test_spsc_threads () {
+  util::spsc_queue<int> blocking(8);
+  produce_consume(blocking, 1, 1, 100000);
+
+  util::spsc_queue<int, false> spinning(8);
+  produce_consume(spinning, 1, 1, 100000);
+}
+
+// --------------------------------------------------------------------------
+void test_main (const testing::start_params&) {
+  testing::log_info("Running " __FILE__);
+  run_test(test_blocking_bulk);
+  run_test(test_blocking_bulk_threads);
+  run_test(test_blocking_spinning);
+  run_test(test_blocking_metrics);
+  run_test(test_blocking_close);
+  run_test(test_close_wakes_waiters);
+  run_test(test_bounded_overflow);
+  run_test(test_bounded_empty_waiter);
+  run_test(test_bounded_not_empty_watcher);
+  run_test(test_bounded_threads);
+  run_test(test_delay_order);
+  run_test(test_delay_earlier_wakes);
+  run_test(test_delay_grow_while_waiting);
+  run_test(test_latest_value);
+  run_test(test_mpmc_fifo);
+  run_test(test_mpmc_threads);
+  run_test(test_mpmc_no_default);
+  run_test(test_mpmc_not_empty_watcher);
+  run_test(test_multicast_ring);
+  run_test(test_priority_bands);
+  run_test(test_priority_grow);
+  run_test(test_priority_aging);
+  run_test(test_priority_threads);
+  run_test(test_sharded_bulk);
+  run_test(test_sharded_fan_in);
+  run_test(test_spsc_move_only);
+  run_test(test_spsc_threads);
+}
+
+// --------------------------------------------------------------------------
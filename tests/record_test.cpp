@@ -0,0 +1,110 @@
+#include <util/record_reader.h>
+#include <testing/testing.h>
+
+using namespace util::record;
+
+// --------------------------------------------------------------------------
+void test_line_scanner () {
+  std::istringstream buffer("first\r\n\nthird line\nlast");
+  line_scanner scanner(buffer, 4);
+  std::vector<std::string> lines;
+  std::string_view line;
+  while (scanner.next(line)) {
+    lines.emplace_back(line);
+  }
+
+  EXPECT_EQUAL(lines.size(), 4);
+  EXPECT_EQUAL(lines[0], std::string("first"));
+  EXPECT_EQUAL(lines[1], std::string());
+  EXPECT_EQUAL(lines[2], std::string("third line"));
+  EXPECT_EQUAL(lines[3], std::string("last"));
+}
+
+// --------------------------------------------------------------------------
+void test_parse_field () {
+  int i = 7;
+  EXPECT_EQUAL(parse_field("+42", i), true);
+  EXPECT_EQUAL(i, 42);
+  EXPECT_EQUAL(parse_field("4x", i), false);
+  EXPECT_EQUAL(i, 0);
+
+  double d = 1.0;
+  EXPECT_EQUAL(parse_field("-2.5", d), true);
+  EXPECT_EQUAL(d, -2.5);
+  EXPECT_EQUAL(parse_field("", d), true);
+  EXPECT_EQUAL(d, 0.0);
+
+  bool b = false;
+  EXPECT_EQUAL(parse_field("true", b), true);
+  EXPECT_EQUAL(b, true);
+}
+
+// --------------------------------------------------------------------------
+void test_fixed_width_reader () {
+  typedef fixed_width_reader<std::string_view, int, util::csv::skip, double> test_reader;
+
+  std::istringstream buffer("NAME      NR  XX VALUE\n"
+                            "Alpha     12  ab  1.5\n"
+                            "Beta       3\n");
+  int count = 0;
+  test_reader::read(buffer, {{{0, 10}, {10, 4}, {14, 3}, {17, 5}}}, true, [&] (const test_reader::tuple& t) {
+    switch (count) {
+      case 0:
+        EXPECT_EQUAL(std::get<0>(t), std::string_view("Alpha"));
+        EXPECT_EQUAL(std::get<1>(t), 12);
+        EXPECT_EQUAL(std::get<3>(t), 1.5);
+      break;
+      case 1:
+        EXPECT_EQUAL(std::get<0>(t), std::string_view("Beta"));
+        EXPECT_EQUAL(std::get<1>(t), 3);
+        EXPECT_EQUAL(std::get<3>(t), 0.0);
+      break;
+    }
+    ++count;
+  });
+  EXPECT_EQUAL(count, 2);
+}
+
+// --------------------------------------------------------------------------
+void test_ndjson_reader () {
+  typedef ndjson_reader<int, std::string, double, bool> test_reader;
+
+  std::istringstream buffer("{\"id\": 1, \"name\": \"a\\\"b\\u00e4\", \"tags\": [1, {\"x\": 2}], \"value\": 2.5, \"ok\": true}\n"
+                            "\n"
+                            "{\"value\": null, \"id\": \"2\", \"extra\": {}}\n"
+                            "{\"id\": 3,\n"
+                            "{}\n");
+  int count = 0;
+  test_reader::read(buffer, {{"id", "name", "value", "ok"}}, [&] (const test_reader::tuple& t) {
+    switch (count) {
+      case 0:
+        EXPECT_EQUAL(std::get<0>(t), 1);
+        EXPECT_EQUAL(std::get<1>(t), std::string("a\"b\xc3\xa4"));
+        EXPECT_EQUAL(std::get<2>(t), 2.5);
+        EXPECT_EQUAL(std::get<3>(t), true);
+      break;
+      case 1:
+        EXPECT_EQUAL(std::get<0>(t), 2);
+        EXPECT_EQUAL(std::get<1>(t), std::string());
+        EXPECT_EQUAL(std::get<2>(t), 0.0);
+        EXPECT_EQUAL(std::get<3>(t), false);
+      break;
+      case 2:
+        EXPECT_EQUAL(std::get<0>(t), 0);
+      break;
+    }
+    ++count;
+  });
+  EXPECT_EQUAL(count, 3);
+}
+
+// --------------------------------------------------------------------------
+void test_main (const testing::start_params&) {
+  testing::log_info("Running " __FILE__);
+  run_test(test_line_scanner);
+  run_test(test_parse_field);
+  run_test(test_fixed_width_reader);
+  run_test(test_ndjson_reader);
+}
+
+// --------------------------------------------------------------------------
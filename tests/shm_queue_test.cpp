@@ -0,0 +1,160 @@
+#include <util/shm_queue.h>
+#include <testing/testing.h>
+
+#include <string>
+#include <thread>
+
+#ifdef UTIL_HAS_SHM_QUEUE
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+// --------------------------------------------------------------------------
+std::string segment (const char* name) {
+  return std::string("util_test_") + name + "_" + std::to_string(::getpid());
+}
+
+// --------------------------------------------------------------------------
+void test_shm_frames () {
+  util::shm_frame_queue queue(segment("frames"), 100);
+  EXPECT_EQUAL(queue.capacity(), 128);
+  EXPECT_EQUAL(queue.max_frame_size(), 60);
+  EXPECT_EQUAL(queue.isEmpty(), true);
+  EXPECT_EQUAL(queue.try_pop().has_value(), false);
+  EXPECT_EQUAL(queue.pop(std::chrono::milliseconds(1)).has_value(), false);
+
+  // wraps around several times, frames never split
+  for (int i = 0; i < 100; ++i) {
+    const std::string text(static_cast<std::size_t>(i % 50), static_cast<char>('a' + i % 26));
+    EXPECT_EQUAL(queue.try_enqueue(text.data(), text.size()), true);
+    std::string read;
+    EXPECT_EQUAL(queue.try_consume([&] (const char* data, std::size_t size) {
+      read.assign(data, size);
+    }), true);
+    EXPECT_EQUAL(read, text);
+  }
+  // a frame of max size fits into an empty ring at any position
+  const char full[60] = {};
+  EXPECT_EQUAL(queue.try_enqueue(full, sizeof(full)), true);
+  EXPECT_EQUAL(queue.try_pop()->size(), 60);
+}
+
+// --------------------------------------------------------------------------
+void test_shm_full () {
+  util::shm_frame_queue queue(segment("full"), 128);
+  const char full[60] = {};
+  EXPECT_EQUAL(queue.try_enqueue(full, sizeof(full)), true);
+  EXPECT_EQUAL(queue.try_enqueue(full, sizeof(full)), true);
+  EXPECT_EQUAL(queue.try_enqueue(full, 1), false);
+  EXPECT_EQUAL(queue.enqueue(full, 1, std::chrono::milliseconds(1)), false);
+
+  bool thrown = false;
+  try {
+    queue.try_enqueue(full, 61);
+  } catch (const std::invalid_argument&) {
+    thrown = true;
+  }
+  EXPECT_EQUAL(thrown, true);
+
+  queue.close();
+  EXPECT_EQUAL(queue.enqueue(full, 1), false);
+  EXPECT_EQUAL(queue.pop()->size(), 60);
+  EXPECT_EQUAL(queue.pop()->size(), 60);
+  EXPECT_EQUAL(queue.pop().has_value(), false);
+}
+
+// --------------------------------------------------------------------------
+struct record {
+  long id;
+  double value;
+};
+
+void test_shm_threads () {
+  const std::string name = segment("threads");
+  util::shm_queue<record> producer(name, 16);
+  util::shm_queue<record> consumer(name);
+  EXPECT_EQUAL(consumer.capacity(), producer.capacity());
+
+  const long count = 100000;
+  std::thread t([&] () {
+    for (long i = 1; i <= count; ++i) {
+      producer.enqueue({i, i * 0.5});
+    }
+    producer.close();
+  });
+  long sum = 0, expected = 1;
+  bool ordered = true;
+  while (std::optional<record> r = consumer.pop()) {
+    ordered &= (r->id == expected++) && (r->value == r->id * 0.5);
+    sum += r->id;
+  }
+  t.join();
+  EXPECT_EQUAL(ordered, true);
+  EXPECT_EQUAL(sum, count * (count + 1) / 2);
+  EXPECT_EQUAL(consumer.dequeue().id, 0);
+}
+
+// --------------------------------------------------------------------------
+void test_shm_processes () {
+  const std::string name = segment("processes");
+  const long count = 100000;
+  util::shm_queue<long> queue(name, 64);
+
+  const pid_t child = ::fork();
+  if (child == 0) {
+    int status = 0;
+    try {
+      util::shm_queue<long> in(name);
+      long expected = 1;
+      while (std::optional<long> i = in.pop()) {
+        if (*i != expected++) {
+          status = 1;
+        }
+      }
+      if (expected != count + 1) {
+        status = 2;
+      }
+    } catch (...) {
+      status = 3;
+    }
+    ::_exit(status);
+  }
+
+  for (long i = 1; i <= count; ++i) {
+    queue.enqueue(i);
+  }
+  queue.close();
+  int status = -1;
+  ::waitpid(child, &status, 0);
+  EXPECT_EQUAL(WIFEXITED(status), true);
+  EXPECT_EQUAL(WEXITSTATUS(status), 0);
+}
+
+// --------------------------------------------------------------------------
+void test_shm_open_missing () {
+  bool thrown = false;
+  try {
+    util::shm_frame_queue queue(segment("missing"));
+  } catch (const std::system_error&) {
+    thrown = true;
+  }
+  EXPECT_EQUAL(thrown, true);
+}
+
+#endif // UTIL_HAS_SHM_QUEUE
+
+// --------------------------------------------------------------------------
+void test_main (const testing::start_params&) {
+  testing::log_info("Running " __FILE__);
+#ifdef UTIL_HAS_SHM_QUEUE
+  run_test(test_shm_frames);
+  run_test(test_shm_full);
+  run_test(test_shm_threads);
+  run_test(test_shm_processes);
+  run_test(test_shm_open_missing);
+#else
+  testing::log_info("No shared memory queue on this platform, tests skipped");
+#endif
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,193 @@
+#include <util/char_class.h>
+#include <util/string_util.h>
+#include <testing/testing.h>
+
+#include <list>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace util::string;
+
+// --------------------------------------------------------------------------
+void test_starts_ends_with () {
+  const std::string text = "prefix.body.suffix";
+  EXPECT_EQUAL(starts_with(text, "prefix"), true);
+  EXPECT_EQUAL(starts_with(std::string_view(text).substr(7), "body"), true);
+  EXPECT_EQUAL(starts_with("abc", "abcd"), false);
+  EXPECT_EQUAL(starts_with("abc", ""), true);
+  EXPECT_EQUAL(ends_with(text, std::string(".suffix")), true);
+  EXPECT_EQUAL(ends_with("abc", "xabc"), false);
+  EXPECT_EQUAL(ends_with("", ""), true);
+}
+
+// --------------------------------------------------------------------------
+void test_split () {
+  typedef std::vector<std::string> strings;
+  EXPECT_EQUAL(split<','>("a,b,,c") == strings({"a", "b", "", "c"}), true);
+  EXPECT_EQUAL(split<','>(",a,") == strings({"", "a"}), true);
+  EXPECT_EQUAL(split<','>("").empty(), true);
+  EXPECT_EQUAL(split<'\n'>("a\nb\n") == strings({"a", "b", ""}), true);
+
+  const std::string line = "key = value ; other";
+  const std::vector<std::string_view> parts = split_view<';'>(line);
+  EXPECT_EQUAL(parts.size(), 2);
+  EXPECT_EQUAL(parts[0].data(), line.data());
+  EXPECT_EQUAL(trim_view(parts[1]), std::string_view("other"));
+}
+
+// --------------------------------------------------------------------------
+std::vector<std::string> tokens (const split_range& range) {
+  std::vector<std::string> v;
+  for (std::string_view t : range) {
+    v.emplace_back(t);
+  }
+  return v;
+}
+
+void test_tokenize () {
+  typedef std::vector<std::string> strings;
+  EXPECT_EQUAL(tokens(tokenize("a;b;;c", ';')) == strings({"a", "b", "", "c"}), true);
+  EXPECT_EQUAL(tokens(tokenize("a;b;", ';')) == strings({"a", "b"}), true);
+  EXPECT_EQUAL(tokens(tokenize("a;b\n", ';')) == strings({"a", "b\n", ""}), true);
+  EXPECT_EQUAL(tokens(tokenize("", ';')).empty(), true);
+  EXPECT_EQUAL(tokens(tokenize(";", ';')) == strings({""}), true);
+
+  EXPECT_EQUAL(tokens(tokenize("a::b:c::", "::")) == strings({"a", "b:c"}), true);
+  EXPECT_EQUAL(tokens(tokenize("::a:", "::")) == strings({"", "a:"}), true);
+  EXPECT_EQUAL(tokens(tokenize("a<->b<-c", "<->")) == strings({"a", "b<-c"}), true);
+  EXPECT_EQUAL(tokens(tokenize("abc", "")) == strings({"abc"}), true);
+
+  const std::string line = "one two three";
+  split_range range = tokenize(line, ' ');
+  split_range::iterator i = range.begin();
+  EXPECT_EQUAL(i->data(), line.data());
+  EXPECT_EQUAL(*i++, std::string_view("one"));
+  EXPECT_EQUAL(*i, std::string_view("two"));
+  EXPECT_EQUAL(std::distance(range.begin(), range.end()), 3);
+  EXPECT_EQUAL(++i != range.end(), true);
+  EXPECT_EQUAL(++i == range.end(), true);
+}
+
+// --------------------------------------------------------------------------
+void test_merge () {
+  const std::vector<std::string> strings = {"a", "b", "c"};
+  const std::vector<std::string_view> views = {"x", "y"};
+  EXPECT_EQUAL(merge(strings, ", "), std::string("a, b, c"));
+  EXPECT_EQUAL(merge<';'>(strings), std::string("a;b;c"));
+  EXPECT_EQUAL(merge<'-'>(views), std::string("x-y"));
+  EXPECT_EQUAL(merge(std::vector<std::string>(), ","), std::string());
+
+  const std::list<std::string> list = {"l", "", "m"};
+  const char* cstrings[] = {"p", "q"};
+  EXPECT_EQUAL(merge(list, "/"), std::string("l//m"));
+  EXPECT_EQUAL(merge<'+'>(cstrings), std::string("p+q"));
+  EXPECT_EQUAL(merge(std::vector<std::string>{"one"}, ", "), std::string("one"));
+  EXPECT_EQUAL(merge(std::vector<std::string_view>(3), ","), std::string(",,"));
+}
+
+// --------------------------------------------------------------------------
+void test_merge_parallel () {
+  std::vector<std::string> parts;
+  std::string expected;
+  for (int i = 0; i < 300000; ++i) {
+    parts.push_back("part " + std::to_string(i) + " of the join");
+    if (i) {
+      expected += ", ";
+    }
+    expected += parts.back();
+  }
+  EXPECT_EQUAL(merge(parts, ", ") == expected, true);
+  EXPECT_EQUAL(merge(parts, ", ", 4) == expected, true);
+  const std::vector<std::string_view> views(parts.begin(), parts.end());
+  EXPECT_EQUAL(merge(views, ", ", 3) == expected, true);
+  EXPECT_EQUAL(merge(parts, ", ", 16) == expected, true);
+  EXPECT_EQUAL(merge(parts, "", 4).size(), expected.size() - 2 * (parts.size() - 1));
+}
+
+// --------------------------------------------------------------------------
+void test_trim () {
+  const std::string text = " \t text with spaces \n";
+  const std::string_view view = trim_view(text);
+  EXPECT_EQUAL(view, std::string_view("text with spaces"));
+  EXPECT_EQUAL(view.data(), text.data() + 3);
+  EXPECT_EQUAL(ltrim_view(text), std::string_view("text with spaces \n"));
+  EXPECT_EQUAL(rtrim_view(text), std::string_view(" \t text with spaces"));
+  EXPECT_EQUAL(trim_view("   ").empty(), true);
+  EXPECT_EQUAL(trimed(text), std::string("text with spaces"));
+  EXPECT_EQUAL(ltrimed("  a "), std::string("a "));
+  EXPECT_EQUAL(rtrimed("  a "), std::string("  a"));
+}
+
+// --------------------------------------------------------------------------
+void test_replace () {
+  std::string s = "a-b-c";
+  replace(s, std::string_view("-"), std::string_view("--"));
+  EXPECT_EQUAL(s, std::string("a--b--c"));
+  replace(s, "--", "+");
+  EXPECT_EQUAL(s, std::string("a+b+c"));
+  replace(s, std::string(), std::string("x"));
+  EXPECT_EQUAL(s, std::string("a+b+c"));
+  EXPECT_EQUAL(replaced("aaa", std::string("a"), std::string("b")), std::string("bbb"));
+}
+
+// --------------------------------------------------------------------------
+void test_char_class () {
+  constexpr util::char_class digits("0123456789");
+  static_assert(digits.contains('7') && !digits.contains('a'), "compile time class");
+  EXPECT_EQUAL(digits.is_ascii(), true);
+  EXPECT_EQUAL(util::char_class("a\xe4").is_ascii(), false);
+
+  // compare with the std::string search for random texts, long enough for the block search
+  const std::string sets[] = {" \t\n", "0123456789", "(){}[],.;:'\"!@#$%^&/*-+", "a\xe4\xff", std::string()};
+  std::mt19937 rng(4711);
+  std::uniform_int_distribution<int> byte(0, 255);
+  for (const std::string& set : sets) {
+    const util::char_class c(set);
+    for (int round = 0; round < 50; ++round) {
+      std::string text(static_cast<std::size_t>(round * 3), ' ');
+      for (char& ch : text) {
+        ch = (byte(rng) < 64 && !set.empty()) ? set[static_cast<std::size_t>(byte(rng)) % set.size()]
+                                              : static_cast<char>(byte(rng));
+      }
+      for (std::size_t pos : {std::size_t(0), std::size_t(5), std::size_t(40), text.size(), std::string::npos}) {
+        const std::size_t from = std::min(pos, text.size());
+        EXPECT_EQUAL(util::find_first_in(text, c, from), text.find_first_of(set, from));
+        EXPECT_EQUAL(util::find_first_not_in(text, c, from), text.find_first_not_of(set, from));
+        EXPECT_EQUAL(util::find_last_in(text, c, pos), text.find_last_of(set, pos));
+        EXPECT_EQUAL(util::find_last_not_in(text, c, pos), text.find_last_not_of(set, pos));
+        // the char by char search, whatever the cpu supports
+        const std::size_t end = std::min(pos, text.size() - 1) + 1;
+        EXPECT_EQUAL(util::detail::scalar_find_first<true>(text, c, from), text.find_first_of(set, from));
+        EXPECT_EQUAL(util::detail::scalar_find_last<false>(text, c, text.empty() ? 0 : end), text.find_last_not_of(set, pos));
+      }
+    }
+  }
+}
+
+// --------------------------------------------------------------------------
+void test_find_space () {
+  const std::string text = "call(first, second)";
+  EXPECT_EQUAL(find_left_space(text, 9), 5);
+  EXPECT_EQUAL(find_left_space(text, 3), 0);
+  EXPECT_EQUAL(find_right_space(text, 6), 11);
+  EXPECT_EQUAL(find_right_space(text, 12), 18);
+  EXPECT_EQUAL(find_right_space(text, 18), text.size());
+}
+
+// --------------------------------------------------------------------------
+void test_main (const testing::start_params&) {
+  testing::log_info("Running " __FILE__);
+  run_test(test_starts_ends_with);
+  run_test(test_split);
+  run_test(test_tokenize);
+  run_test(test_merge);
+  run_test(test_merge_parallel);
+  run_test(test_trim);
+  run_test(test_replace);
+  run_test(test_char_class);
+  run_test(test_find_space);
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,106 @@
+#include <util/thread_pool.h>
+#include <testing/testing.h>
+
+#include <numeric>
+#include <stdexcept>
+
+// --------------------------------------------------------------------------
+void test_submit () {
+  util::thread_pool pool(3);
+  EXPECT_EQUAL(pool.size(), 3);
+
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < 100; ++i) {
+    results.emplace_back(pool.submit([] (int a, int b) {
+      return a * b;
+    }, i, 2));
+  }
+  int sum = 0;
+  for (auto& f : results) {
+    sum += f.get();
+  }
+  EXPECT_EQUAL(sum, 9900);
+
+  auto failing = pool.submit([] () -> int {
+    throw std::runtime_error("task failed");
+  });
+  bool thrown = false;
+  try {
+    failing.get();
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  EXPECT_EQUAL(thrown, true);
+}
+
+// --------------------------------------------------------------------------
+void test_parallel_for () {
+  util::thread_pool pool(4);
+  std::vector<int> v(100000, 0);
+  pool.parallel_for(0, v.size(), [&] (std::size_t i) {
+    v[i] = static_cast<int>(i % 7);
+  });
+  long expected = 0;
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    expected += i % 7;
+  }
+  EXPECT_EQUAL(std::accumulate(v.begin(), v.end(), 0L), expected);
+
+  std::atomic<int> calls(0);
+  pool.parallel_for(5, 5, [&] (std::size_t) { ++calls; });
+  pool.parallel_for(5, 8, [&] (std::size_t) { ++calls; }, 100);
+  EXPECT_EQUAL(calls.load(), 3);
+
+  bool thrown = false;
+  try {
+    pool.parallel_for(0, 1000, [] (std::size_t i) {
+      if (i == 777) {
+        throw std::out_of_range("777");
+      }
+    }, 10);
+  } catch (const std::out_of_range&) {
+    thrown = true;
+  }
+  EXPECT_EQUAL(thrown, true);
+}
+
+// --------------------------------------------------------------------------
+void test_nested () {
+  util::thread_pool pool(2);
+  std::atomic<long> sum(0);
+  pool.parallel_for(0, 16, [&] (std::size_t i) {
+    pool.parallel_for(0, 1000, [&] (std::size_t j) {
+      sum += static_cast<long>(i * j);
+    }, 50);
+  }, 1);
+  EXPECT_EQUAL(sum.load(), 120L * 499500);
+
+  int a = 0, b = 0, c = 0;
+  pool.parallel_invoke([&] () { a = 1; }, [&] () { b = 2; }, [&] () { c = 3; });
+  EXPECT_EQUAL(a + b + c, 6);
+}
+
+// --------------------------------------------------------------------------
+void test_drain_on_destruction () {
+  std::atomic<int> done(0);
+  {
+    util::thread_pool pool(2);
+    for (int i = 0; i < 1000; ++i) {
+      pool.execute([&] () {
+        ++done;
+      });
+    }
+  }
+  EXPECT_EQUAL(done.load(), 1000);
+}
+
+// --------------------------------------------------------------------------
+void test_main (const testing::start_params&) {
+  testing::log_info("Running " __FILE__);
+  run_test(test_submit);
+  run_test(test_parallel_for);
+  run_test(test_nested);
+  run_test(test_drain_on_destruction);
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,305 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ Impl: work stealing thread pool
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <thread>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include "thread_pool.h"
+
+namespace util {
+
+  namespace {
+
+    // --------------------------------------------------------------------------
+    /*
+     * Chase-Lev deque after "Correct and Efficient Work-Stealing for Weak Memory Models".
+     * Only the owner calls push and pop, any thread may call steal.
+     * The fences of the paper are folded into seq_cst accesses of top and bottom.
+     * Outgrown arrays are kept until destruction, because a thief may still read from them.
+     */
+    template<typename T>
+    class chase_lev_deque {
+    public:
+      chase_lev_deque ()
+        : m_top(0)
+        , m_bottom(0)
+        , m_array(new array(64))
+      {
+        m_arrays.emplace_back(m_array.load(std::memory_order_relaxed));
+      }
+
+      chase_lev_deque (const chase_lev_deque&) = delete;
+      chase_lev_deque& operator= (const chase_lev_deque&) = delete;
+
+      void push (T* t) {
+        const std::int64_t b = m_bottom.load(std::memory_order_relaxed);
+        const std::int64_t top = m_top.load(std::memory_order_acquire);
+        array* a = m_array.load(std::memory_order_relaxed);
+        if (b - top >= static_cast<std::int64_t>(a->capacity())) {
+          a = a->grow(top, b);
+          m_arrays.emplace_back(a);
+          m_array.store(a, std::memory_order_release);
+        }
+        a->put(b, t);
+        m_bottom.store(b + 1, std::memory_order_release);
+      }
+
+      T* pop () {
+        const std::int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        array* a = m_array.load(std::memory_order_relaxed);
+        m_bottom.store(b, std::memory_order_seq_cst);
+        std::int64_t top = m_top.load(std::memory_order_seq_cst);
+        if (top > b) {
+          m_bottom.store(b + 1, std::memory_order_relaxed);
+          return nullptr;
+        }
+        T* t = a->get(b);
+        if (top == b) {
+          // last item, race against thieves
+          if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            t = nullptr;
+          }
+          m_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return t;
+      }
+
+      /// @return nullptr if the deque is empty or another thread won the race.
+      T* steal () {
+        std::int64_t top = m_top.load(std::memory_order_seq_cst);
+        const std::int64_t b = m_bottom.load(std::memory_order_seq_cst);
+        if (top >= b) {
+          return nullptr;
+        }
+        T* t = m_array.load(std::memory_order_acquire)->get(top);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+          return nullptr;
+        }
+        return t;
+      }
+
+      bool empty () const {
+        return m_top.load(std::memory_order_acquire) >= m_bottom.load(std::memory_order_acquire);
+      }
+
+    private:
+      struct array {
+        explicit array (std::size_t capacity)
+          : mask(capacity - 1)
+          , cells(new std::atomic<T*>[capacity])
+        {}
+
+        std::size_t capacity () const {
+          return mask + 1;
+        }
+
+        T* get (std::int64_t i) const {
+          return cells[static_cast<std::size_t>(i) & mask].load(std::memory_order_relaxed);
+        }
+
+        void put (std::int64_t i, T* t) {
+          cells[static_cast<std::size_t>(i) & mask].store(t, std::memory_order_relaxed);
+        }
+
+        array* grow (std::int64_t top, std::int64_t bottom) const {
+          array* a = new array(capacity() * 2);
+          for (std::int64_t i = top; i < bottom; ++i) {
+            a->put(i, get(i));
+          }
+          return a;
+        }
+
+        const std::size_t mask;
+        std::unique_ptr<std::atomic<T*>[]> cells;
+      };
+
+      alignas(64) std::atomic<std::int64_t> m_top;
+      alignas(64) std::atomic<std::int64_t> m_bottom;
+      std::atomic<array*> m_array;
+      std::vector<std::unique_ptr<array>> m_arrays;
+    };
+
+    // --------------------------------------------------------------------------
+    struct current_worker {
+      const thread_pool* pool;
+      std::size_t index;
+    };
+
+    thread_local current_worker current = {nullptr, 0};
+
+    constexpr std::size_t no_worker = std::numeric_limits<std::size_t>::max();
+
+    /// Rounds of searching for work before a worker goes to sleep.
+    constexpr int spin_count = 64;
+
+    void run_task (thread_pool::task* t) {
+      std::unique_ptr<thread_pool::task> guard(t);
+      try {
+        (*t)();
+      } catch (...) {}
+    }
+
+  } // namespace
+
+  // --------------------------------------------------------------------------
+  struct alignas(64) thread_pool::worker {
+    chase_lev_deque<task> tasks;
+    std::minstd_rand random;
+    std::thread thread;
+  };
+
+  // --------------------------------------------------------------------------
+  thread_pool::thread_pool (std::size_t workers)
+    : m_stop(false)
+  {
+    const std::size_t count = workers ? workers : std::max(1U, std::thread::hardware_concurrency());
+    m_workers.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      m_workers.emplace_back(new worker());
+      m_workers.back()->random.seed(static_cast<unsigned>(i + 1));
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      m_workers[i]->thread = std::thread([this, i] () {
+        run_worker(i);
+      });
+    }
+  }
+
+  thread_pool::~thread_pool () {
+    m_stop.store(true);
+    m_idle.notify_all();
+    for (auto& w : m_workers) {
+      w->thread.join();
+    }
+    std::lock_guard<std::mutex> lock(m_injected_mutex);
+    for (task* t : m_injected) {
+      delete t;
+    }
+  }
+
+  void thread_pool::execute (task t) {
+    task* p = new task(std::move(t));
+    if (current.pool == this) {
+      m_workers[current.index]->tasks.push(p);
+    } else {
+      std::lock_guard<std::mutex> lock(m_injected_mutex);
+      m_injected.push_back(p);
+    }
+    m_idle.notify_one();
+  }
+
+  bool thread_pool::run_pending_task () {
+    task* t = find_task(current.pool == this ? current.index : no_worker);
+    if (t) {
+      run_task(t);
+      return true;
+    }
+    return false;
+  }
+
+  std::size_t thread_pool::size () const {
+    return m_workers.size();
+  }
+
+  thread_pool::task* thread_pool::find_task (std::size_t index) {
+    if (index != no_worker) {
+      if (task* t = m_workers[index]->tasks.pop()) {
+        return t;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_injected_mutex);
+      if (!m_injected.empty()) {
+        task* t = m_injected.front();
+        m_injected.pop_front();
+        return t;
+      }
+    }
+    const std::size_t count = m_workers.size();
+    static thread_local std::minstd_rand outside(static_cast<unsigned>(std::hash<std::thread::id>()(std::this_thread::get_id())));
+    std::minstd_rand& random = (index != no_worker) ? m_workers[index]->random : outside;
+    const std::size_t start = random() % count;
+    for (std::size_t i = 0; i < count; ++i) {
+      const std::size_t victim = (start + i) % count;
+      if (victim != index) {
+        if (task* t = m_workers[victim]->tasks.steal()) {
+          return t;
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  void thread_pool::run_worker (std::size_t index) {
+    current = {this, index};
+    for (;;) {
+      task* t = nullptr;
+      for (int i = 0; (i < spin_count) && !t; ++i) {
+        t = find_task(index);
+        if (!t) {
+          std::this_thread::yield();
+        }
+      }
+      if (!t) {
+        const eventcount::key_type key = m_idle.prepare_wait();
+        t = find_task(index);
+        if (t) {
+          m_idle.cancel_wait();
+        } else if (m_stop.load()) {
+          m_idle.cancel_wait();
+          break;
+        } else {
+          m_idle.wait(key);
+          continue;
+        }
+      }
+      run_task(t);
+    }
+    current = {nullptr, 0};
+  }
+
+  // --------------------------------------------------------------------------
+  void thread_pool::task_group::wait () {
+    // Help with pending tasks, sleep once none is left to take. The last task of the group
+    // notifies done, tasks queued meanwhile are taken by the workers woken for them.
+    while (m_state->pending.load(std::memory_order_acquire) > 0) {
+      if (m_pool.run_pending_task()) {
+        continue;
+      }
+      m_state->done.await([&] () {
+        return m_state->pending.load(std::memory_order_acquire) == 0;
+      });
+    }
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    if (m_state->error) {
+      std::exception_ptr error = m_state->error;
+      m_state->error = nullptr;
+      std::rethrow_exception(error);
+    }
+  }
+
+} // namespace util
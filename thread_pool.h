@@ -0,0 +1,213 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: work stealing thread pool
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// --------------------------------------------------------------------------
+//
+// Library includes
+//
+#include <util/eventcount.h>
+#include <util/util-export.h>
+
+
+namespace util {
+
+  /**
+   * Thread pool where each worker owns a Chase-Lev deque. A worker pushes and pops
+   * tasks at the bottom of its own deque, idle workers steal from the top of a random victim.
+   * Tasks from threads outside the pool go to a shared injection queue.
+   * Idle workers sleep on an eventcount.
+   */
+  class UTIL_EXPORT thread_pool {
+  public:
+    typedef std::function<void()> task;
+
+    /// Starts workers threads, 0 uses std::thread::hardware_concurrency().
+    explicit thread_pool (std::size_t workers = 0);
+
+    /// Runs all pending tasks and joins the workers.
+    ~thread_pool ();
+
+    thread_pool (const thread_pool&) = delete;
+    thread_pool& operator= (const thread_pool&) = delete;
+
+    /// Schedule a task, exceptions thrown by it are ignored.
+    void execute (task t);
+
+    /// Schedule fn(args...). @return a future for the result or the exception.
+    /// Don't wait for the future inside of a task, use a task_group there.
+    template<typename F, typename ... Args>
+    auto submit (F&& fn, Args&& ... args) -> std::future<std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>> {
+      typedef std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...> R;
+      auto job = std::make_shared<std::packaged_task<R()>>(
+        [f = std::forward<F>(fn), a = std::make_tuple(std::forward<Args>(args)...)] () mutable {
+          return std::apply(std::move(f), std::move(a));
+        });
+      std::future<R> result = job->get_future();
+      execute([job] () {
+        (*job)();
+      });
+      return result;
+    }
+
+    /// Runs one pending task on the calling thread. @return false if no task was found.
+    bool run_pending_task ();
+
+    /// @return the number of worker threads.
+    std::size_t size () const;
+
+    /**
+     * Tasks that can be waited for together. While waiting, the calling thread runs pending tasks,
+     * so groups can be nested inside of tasks without blocking the workers.
+     */
+    class task_group {
+    public:
+      explicit task_group (thread_pool& pool)
+        : m_pool(pool)
+        , m_state(std::make_shared<state>())
+      {}
+
+      /// Waits for the remaining tasks, exceptions are dropped.
+      ~task_group () {
+        try {
+          wait();
+        } catch (...) {}
+      }
+
+      task_group (const task_group&) = delete;
+      task_group& operator= (const task_group&) = delete;
+
+      template<typename F>
+      void run (F&& fn) {
+        m_state->pending.fetch_add(1, std::memory_order_relaxed);
+        m_pool.execute([s = m_state, f = std::forward<F>(fn)] () mutable {
+          try {
+            f();
+          } catch (...) {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            if (!s->error) {
+              s->error = std::current_exception();
+            }
+          }
+          if (s->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            s->done.notify_all();
+          }
+        });
+      }
+
+      /// Waits until all tasks are done, rethrows the first exception thrown by a task.
+      void wait ();
+
+    private:
+      struct state {
+        state ()
+          : pending(0)
+        {}
+
+        std::atomic<std::size_t> pending;
+        eventcount done;
+        std::mutex mutex;
+        std::exception_ptr error;
+      };
+
+      thread_pool& m_pool;
+      std::shared_ptr<state> m_state;
+    };
+
+    /**
+     * Calls fn(i) for each i in [first, last) in chunks of grain indices.
+     * With grain 0, the range is split into about four chunks per worker.
+     * The calling thread takes part, the first exception is rethrown.
+     */
+    template<typename F>
+    void parallel_for (std::size_t first, std::size_t last, F fn, std::size_t grain = 0) {
+      if (last <= first) {
+        return;
+      }
+      if (grain == 0) {
+        grain = std::max<std::size_t>(1, (last - first) / (4 * size()));
+      }
+      const std::size_t head = first + std::min(grain, last - first);
+      task_group group(*this);
+      for (std::size_t b = head; b < last;) {
+        const std::size_t e = b + std::min(grain, last - b);
+        group.run([&fn, b, e] () {
+          for (std::size_t i = b; i < e; ++i) {
+            fn(i);
+          }
+        });
+        b = e;
+      }
+      for (std::size_t i = first; i < head; ++i) {
+        fn(i);
+      }
+      group.wait();
+    }
+
+    /// Calls all functions in parallel, the last one on the calling thread. The first exception is rethrown.
+    template<typename F, typename ... Fs>
+    void parallel_invoke (F&& fn, Fs&& ... fns) {
+      task_group group(*this);
+      invoke_all(group, std::forward<F>(fn), std::forward<Fs>(fns)...);
+      group.wait();
+    }
+
+  private:
+    template<typename F>
+    static void invoke_all (task_group&, F&& fn) {
+      fn();
+    }
+
+    template<typename F, typename ... Fs>
+    static void invoke_all (task_group& group, F&& fn, Fs&& ... fns) {
+      group.run(std::forward<F>(fn));
+      invoke_all(group, std::forward<Fs>(fns)...);
+    }
+
+    struct worker;
+
+    task* find_task (std::size_t index);
+    void run_worker (std::size_t index);
+
+    std::vector<std::unique_ptr<worker>> m_workers;
+
+    /// Tasks from threads outside of the pool.
+    std::deque<task*> m_injected;
+    std::mutex m_injected_mutex;
+
+    /// Idle workers sleep here.
+    eventcount m_idle;
+    std::atomic<bool> m_stop;
+  };
+
+} // namespace util
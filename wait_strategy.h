@@ -0,0 +1,97 @@
+/**
+ * @copyright (c) 2015-2021 Ing. Buero Rothfuss
+ *                          Riedlinger Str. 8
+ *                          70327 Stuttgart
+ *                          Germany
+ *                          http://www.rothfuss-web.de
+ *
+ * @author    <a href="mailto:armin@rothfuss-web.de">Armin Rothfuss</a>
+ *
+ * Project    utility lib
+ *
+ * @brief     C++ API: wait strategies for queues
+ *
+ * @license   MIT license. See accompanying file LICENSE.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------
+//
+// Common includes
+//
+#include <thread>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace util {
+
+  /// Hint to the cpu that the thread is busy waiting.
+  inline void cpu_relax () {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+  }
+
+  /**
+   * Waiting parks the thread immediately, no cpu time is burned.
+   */
+  struct park_wait {
+    static constexpr unsigned spins = 0;
+    static constexpr unsigned yields = 0;
+  };
+
+  /**
+   * Waiting checks the condition Spins times with a pause in between, then Yields times
+   * with a yield to the scheduler in between, before the thread is parked.
+   * A waiter that catches the condition in this phase saves the wake up latency
+   * and the notifier saves the system call.
+   */
+  template<unsigned Spins = 1000, unsigned Yields = 50>
+  struct spin_then_park {
+    static constexpr unsigned spins = Spins;
+    static constexpr unsigned yields = Yields;
+  };
+
+  /// @return false on a single cpu, where pausing only delays the thread we are waiting for.
+  inline bool spinning_pays () {
+    static const bool multi_core = std::thread::hardware_concurrency() > 1;
+    return multi_core;
+  }
+
+  /// @return true, if W busy waits before parking.
+  template<typename W>
+  constexpr bool is_spinning () {
+    return (W::spins + W::yields) > 0;
+  }
+
+  /**
+   * Busy waits following strategy W until pred returns true.
+   * The pause phase is skipped on a single cpu.
+   * @return false if the thread should be parked now.
+   */
+  template<typename W, typename P>
+  bool spin_until (P&& pred) {
+    const unsigned spins = ((W::spins > 0) && spinning_pays()) ? W::spins : 0;
+    for (unsigned i = 0; i < spins; ++i) {
+      if (pred()) {
+        return true;
+      }
+      cpu_relax();
+    }
+    for (unsigned i = 0; i < W::yields; ++i) {
+      if (pred()) {
+        return true;
+      }
+      std::this_thread::yield();
+    }
+    return false;
+  }
+
+} // namespace util